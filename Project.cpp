@@ -16,10 +16,19 @@
 #include "buffers/VAO.h"
 #include "buffers/VBO.h"
 #include "buffers/EBO.h"
+#include "buffers/UBO.h"
 #include "texture.h"
+#include "texture_cache.h"
 #include "shapes/flat_cave.h"
+#include "shapes/lod_cave.h"
+#include "shapes/draw_list.h"
 #include "generation/cave_generator.h"
 #include "generation/mesh_generator.h"
+#include "generation/pipeline_profiler.h"
+#include "generation/cave_cache.h"
+#include "generation/cave_mesh_file.h"
+#include "generation/mesh_exporter.h"
+#include "generation/vertex_quantiser.h"
 #include "camera.h"
 
 const unsigned int SCR_WIDTH = 1600;
@@ -28,21 +37,61 @@ const unsigned int SCR_HEIGHT = 900;
 GLFWwindow* window;
 Camera camera(SCR_WIDTH, SCR_HEIGHT);
 
-std::vector<std::vector<GLfloat>> verticesWalls;
-std::vector<std::vector<GLfloat>> verticesFloor;
+// Vertices of the newest cave. They are moved into the vertex buffers when the cave is uploaded, after that only the chunks are kept.
+std::vector<GLfloat> verticesWalls;
+std::vector<GLfloat> verticesFloor;
+
+// Per level vertices and chunks, only filled when the cave is generated in level of detail mode.
+std::vector<std::vector<GLfloat>> lodVerticesWalls;
+std::vector<std::vector<GLfloat>> lodVerticesFloor;
+std::vector<std::vector<MeshChunk>> lodChunks;
+
+const int lodLevelCount = 3;
+const int lodChunkSize = 16;
+const glm::vec3 caveOffset = glm::vec3(-32.0f, -10.0f, -40.0f);
+const int caveBorderSize = 5;
+
+CaveCache caveCache;
+VertexQuantiser vertexQuantiser(0.5f); // Half of the square size every single level cave is generated with.
 
 bool wireframeMode[1] = { false };
 bool flatMode[1] = { false };
+bool greedyMergeMode[1] = { false };
+bool simplifyWallsMode[1] = { false };
+bool lodMode[1] = { false };
+bool cacheMode[1] = { true };
+bool quantiseMode[1] = { false };
+bool tiledSmoothingMode[1] = { false };
+bool fusedFillMode[1] = { false };
 int inputWidth[1] = { 32 };
 int inputHeight[1] = { 64 };
 float inputFillPercentage[1] = { 0.42f };
+float inputWallTolerance[1] = { 0.0f };
+float inputLodDistance[1] = { 40.0f };
 char inputSeed[11] = { "" };
+char inputMeshPath[128] = { "cave.cavm" };
 
 int currentSeed = 0;
+CaveCacheKey currentCaveKey; // Everything the cave being shown was generated from.
+bool traceExported = false;
+bool loadedFromCache = false;
+bool quantisedCave = false;
+bool meshLoaded = false; // The cave being shown came from a mesh file, so currentCaveKey does not describe it.
+std::string meshFileStatus = "";
 
 void CaveGenerationInit(int width, int height, int fillPercentage, int seed);
-void GenerateButton(FlatCave& walls, FlatCave& ceiling, FlatCave& floor);
-void Debug(FlatCave& walls, FlatCave& ceiling, FlatCave& floor);
+void LodGenerationInit(CaveGenerator& caveGenerator);
+void LodCaveInit(LodCave& lodCave);
+void QuantiseInit();
+FlatCave CreateWalls(std::vector<Texture>& wallTextures);
+FlatCave CreateFloor();
+void UploadCave(FlatCave& walls, FlatCave& ceiling);
+void GenerateButton(FlatCave& walls, FlatCave& ceiling, LodCave& lodCave);
+void SaveMeshButton();
+void LoadMeshButton(FlatCave& walls, FlatCave& ceiling, LodCave& lodCave);
+void ExportButton(const char* extension);
+void Debug(FlatCave& walls, FlatCave& ceiling, LodCave& lodCave);
+void PipelineStats();
 void MouseCallback(GLFWwindow* window, double xpos, double ypos);
 void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
 
@@ -71,20 +120,38 @@ int main()
 	glEnable(GL_DEPTH_TEST);
 
 	CaveGenerationInit(32, 64, 42, -1);
+	QuantiseInit();
 
 	Shader triangleShader("media/shaders/triangle.vert", "media/shaders/triangle.frag");
 	Shader triangleTexturedShader("media/shaders/triangleTextured.vert", "media/shaders/triangleTextured.frag");
 
-	FlatCave caveWalls(verticesWalls, false, std::vector<Texture>() = { Texture("media/textures/rock.jpg", GL_RGB, 1) });
-	FlatCave caveCeiling(verticesFloor, false);
-	FlatCave caveFloor(verticesFloor, false);
+	std::vector<Texture> wallTextures = std::vector<Texture>() = { TextureCache::Get().Acquire("media/textures/rock.jpg", GL_RGB, 1) };
+	ScopedTimer uploadTimer("VBO upload");
+	FlatCave caveWalls = CreateWalls(wallTextures);
+	FlatCave caveCeiling = CreateFloor(); // Also drawn lower down as the floor, the two are the same shape.
+	uploadTimer.Stop();
+	LodCave caveLod;
+	LodCaveInit(caveLod);
 
 	glfwMakeContextCurrent(window);
 
 	glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
 
+	// The view and projection are the same for every draw in a frame, so they are uploaded once into a block both cave shaders read.
+	UBO frameUniforms(sizeof(glm::mat4), Shader::frameUniformsBinding);
+	triangleShader.BindUniformBlock("FrameUniforms", Shader::frameUniformsBinding);
+	triangleTexturedShader.BindUniformBlock("FrameUniforms", Shader::frameUniformsBinding);
+
+	GLint triangleModelLocation = triangleShader.GetUniformLocation("model");
+	GLint triangleTexturedModelLocation = triangleTexturedShader.GetUniformLocation("model");
+	triangleTexturedShader.Use();
+	triangleTexturedShader.SetInt("sampleTexture", wallTextures[0].unit);
+
+	DrawList drawList;
+
 	while (!glfwWindowShouldClose(window))
 	{
+		RenderState::Get().BeginFrame();
 		camera.UpdateDeltaTime();
 		camera.Movement();
 
@@ -93,37 +160,43 @@ int main()
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		Debug(caveWalls, caveCeiling, caveFloor);
+		Debug(caveWalls, caveCeiling, caveLod);
+		PipelineStats();
 
 		glm::mat4 view = glm::mat4(1.0f);
 		glm::mat4 model = glm::mat4(1.0f);
-		glm::mat4 fullTransformMatrix = glm::mat4(1.0f);
 
 		view = camera.ViewLookAt(view);	
-		model = glm::translate(model, glm::vec3(-32.0f, -10.0f, -40.0f));
-		fullTransformMatrix = projection * view * model;
+		model = glm::translate(model, caveOffset);
+		glm::mat4 viewProjection = projection * view;
+		frameUniforms.Update(&viewProjection[0][0], sizeof(glm::mat4));
 
 		glm::mat4 modelFloor = glm::mat4(1.0f);
 		modelFloor = glm::translate(modelFloor, glm::vec3(0.0f, -5.0f, 0.0f));
+		modelFloor = model * modelFloor;
 
-		triangleShader.Use();
-		triangleShader.setMat4("fullTransformMatrix", fullTransformMatrix);
-
-		triangleTexturedShader.Use();
-		triangleTexturedShader.setMat4("fullTransformMatrix", fullTransformMatrix);
-		triangleTexturedShader.SetInt("sampleTexture", 0);
-
-		if (!flatMode[0]) 
+		drawList.Clear();
+		if (!caveLod.chunks.empty())
 		{
-			caveWalls.Draw(triangleTexturedShader);
+			caveLod.lodDistance = inputLodDistance[0];
+			caveLod.SelectLevels(camera.cameraPos - caveOffset, viewProjection * model);
+			if (!flatMode[0])
+			{
+				caveLod.QueueWalls(drawList, triangleTexturedShader, triangleTexturedModelLocation, model);
+				caveLod.QueueCeiling(drawList, triangleShader, triangleModelLocation, modelFloor);
+			}
+			caveLod.QueueCeiling(drawList, triangleShader, triangleModelLocation, model);
 		}
-		caveCeiling.Draw(triangleShader);
-
-		triangleShader.setMat4("fullTransformMatrix", fullTransformMatrix * modelFloor);
-		if (!flatMode[0]) 
+		else
 		{
-			caveFloor.Draw(triangleShader);
+			if (!flatMode[0]) 
+			{
+				drawList.Add(triangleTexturedShader, triangleTexturedModelLocation, model, caveWalls, 0, caveWalls.vertexCount);
+				drawList.Add(triangleShader, triangleModelLocation, modelFloor, caveCeiling, 0, caveCeiling.vertexCount);
+			}
+			drawList.Add(triangleShader, triangleModelLocation, model, caveCeiling, 0, caveCeiling.vertexCount);
 		}
+		drawList.Submit();
 
 		ImGui::Render();
 		ImGui_ImplGlfwGL3_RenderDrawData(ImGui::GetDrawData());
@@ -140,19 +213,150 @@ int main()
 
 void CaveGenerationInit(int width, int height, int fillPercentage, int seed)
 {
-	verticesWalls = std::vector<std::vector<GLfloat>>();
-	verticesFloor = std::vector<std::vector<GLfloat>>();
-
+	verticesWalls = std::vector<GLfloat>();
+	verticesFloor = std::vector<GLfloat>();
+	lodVerticesWalls = std::vector<std::vector<GLfloat>>();
+	lodVerticesFloor = std::vector<std::vector<GLfloat>>();
+	lodChunks = std::vector<std::vector<MeshChunk>>();
+
+	PipelineProfiler::Get().Clear();
+	traceExported = false;
+	loadedFromCache = false;
+	meshLoaded = false;
+
+	CaveCacheKey cacheKey = CaveCache::MakeKey(width, height, fillPercentage, seed, caveBorderSize, greedyMergeMode[0], simplifyWallsMode[0], inputWallTolerance[0], fusedFillMode[0]);
+	if (cacheMode[0] && !lodMode[0] && seed != -1)
+	{
+		std::vector<std::vector<int>> cachedMap = std::vector<std::vector<int>>();
+		if (caveCache.Load(cacheKey, cachedMap, verticesFloor, verticesWalls))
+		{
+			currentSeed = seed;
+			currentCaveKey = cacheKey;
+			loadedFromCache = true;
+			return;
+		}
+	}
 
-	CaveGenerator caveGenerator(width, height, fillPercentage, seed);
-	MeshGenerator meshGenerator(caveGenerator.borderedMap, 1);
+	CaveGenerator caveGenerator(width, height, fillPercentage, seed, caveBorderSize, tiledSmoothingMode[0], fusedFillMode[0]);
 
 	currentSeed = caveGenerator.seed;
+	currentCaveKey = cacheKey;
+	currentCaveKey.seed = currentSeed;
 
-	meshGenerator.CreateFinalVerticesLists(verticesFloor, verticesWalls);
+	if (lodMode[0])
+	{
+		LodGenerationInit(caveGenerator);
+		return;
+	}
+
+	MeshGenerator meshGenerator(caveGenerator.borderedMap, 1, greedyMergeMode[0], simplifyWallsMode[0], inputWallTolerance[0]);
+	meshGenerator.CreateFinalVertexBuffers(verticesFloor, verticesWalls);
+
+	if (cacheMode[0])
+	{
+		caveCache.Store(currentCaveKey, caveGenerator.borderedMap, verticesFloor, verticesWalls);
+	}
+} // A cave with a known seed is read from the cache when it has been generated before, every newly generated cave is added to it. Caves with levels of detail are always generated.
+
+void LodGenerationInit(CaveGenerator& caveGenerator)
+{
+	caveGenerator.BuildMapPyramid(lodLevelCount);
+
+	glm::vec3 origin = glm::vec3(0.0f, 0.0f, 0.0f);
+	for (int level = 0; level < caveGenerator.GetMapLevelCount(); level++)
+	{
+		MeshGenerator meshGenerator(caveGenerator.GetMapLevel(level), float(1 << level), greedyMergeMode[0], simplifyWallsMode[0], inputWallTolerance[0], std::max(lodChunkSize >> level, 1), true);
+		if (level == 0)
+		{
+			origin = meshGenerator.squareGrid.GetControlNode(0, 0).position;
+		}
+		else
+		{
+			meshGenerator.Translate(origin - meshGenerator.squareGrid.GetControlNode(0, 0).position);
+		}
+
+		lodVerticesWalls.push_back(std::vector<GLfloat>());
+		lodVerticesFloor.push_back(std::vector<GLfloat>());
+		meshGenerator.CreateFinalVertexBuffers(lodVerticesFloor[level], lodVerticesWalls[level]);
+		lodChunks.push_back(std::move(meshGenerator.chunks));
+	}
+} // Meshes every level of the map pyramid with the same chunk layout. Coarser levels have bigger squares and are moved so their first node sits on the full resolution one.
+
+void LodCaveInit(LodCave& lodCave)
+{
+	if (lodChunks.empty())
+	{
+		return;
+	}
+	std::vector<Texture> wallTextures = std::vector<Texture>();
+	if (lodCave.walls.empty())
+	{
+		wallTextures.push_back(TextureCache::Get().Acquire("media/textures/rock.jpg", GL_RGB, 1));
+	}
+	ScopedTimer timer("VBO upload");
+	lodCave.Build(std::move(lodVerticesWalls), std::move(lodVerticesFloor), lodChunks, wireframeMode[0], wallTextures);
+	lodVerticesWalls.clear();
+	lodVerticesFloor.clear();
 }
 
-void GenerateButton(FlatCave& walls, FlatCave& ceiling, FlatCave& floor)
+void QuantiseInit()
+{
+	quantisedCave = false;
+	if (quantiseMode[0] && lodChunks.empty())
+	{
+		quantisedCave = vertexQuantiser.Quantise(verticesFloor.data(), verticesFloor.size(), verticesWalls.data(), verticesWalls.size());
+	}
+	else
+	{
+		vertexQuantiser.Release();
+	}
+	if (quantisedCave)
+	{
+		std::vector<GLfloat>().swap(verticesWalls);
+		std::vector<GLfloat>().swap(verticesFloor);
+	}
+} // Packs the single level cave into 16 bit vertices when quantising is on. The float buffers are used whenever it is off or the cave does not fit the lattice.
+
+FlatCave CreateWalls(std::vector<Texture>& wallTextures)
+{
+	if (quantisedCave)
+	{
+		return FlatCave(vertexQuantiser.verticesWalls.data(), vertexQuantiser.verticesWalls.size(), vertexQuantiser.latticeSpacing, wireframeMode[0], wallTextures);
+	}
+	return FlatCave(std::move(verticesWalls), wireframeMode[0], wallTextures);
+}
+
+FlatCave CreateFloor()
+{
+	if (quantisedCave)
+	{
+		glm::vec3 colour = glm::vec3(vertexQuantiser.floorColour[0], vertexQuantiser.floorColour[1], vertexQuantiser.floorColour[2]);
+		FlatCave floor = FlatCave(vertexQuantiser.verticesFloor.data(), vertexQuantiser.verticesFloor.size(), vertexQuantiser.latticeSpacing, colour, wireframeMode[0]);
+		vertexQuantiser.Release();
+		return floor;
+	}
+	return FlatCave(std::move(verticesFloor), wireframeMode[0]);
+} // Create the walls first, creating the floor frees whatever vertices are left.
+
+void UploadCave(FlatCave& walls, FlatCave& ceiling)
+{
+	if (quantisedCave)
+	{
+		glm::vec3 colour = glm::vec3(vertexQuantiser.floorColour[0], vertexQuantiser.floorColour[1], vertexQuantiser.floorColour[2]);
+		walls.Upload(vertexQuantiser.verticesWalls.data(), vertexQuantiser.verticesWalls.size(), vertexQuantiser.latticeSpacing, colour);
+		ceiling.Upload(vertexQuantiser.verticesFloor.data(), vertexQuantiser.verticesFloor.size(), vertexQuantiser.latticeSpacing, colour);
+		vertexQuantiser.Release();
+	}
+	else
+	{
+		walls.Upload(std::move(verticesWalls));
+		ceiling.Upload(std::move(verticesFloor));
+	}
+	verticesWalls.clear();
+	verticesFloor.clear();
+} // Hands the vertices over to the GPU, nothing is left of them on this side afterwards.
+
+void GenerateButton(FlatCave& walls, FlatCave& ceiling, LodCave& lodCave)
 {
 	int fillPercentage = int(inputFillPercentage[0] * 100);
 	if (strlen(inputSeed) == 0)
@@ -166,30 +370,110 @@ void GenerateButton(FlatCave& walls, FlatCave& ceiling, FlatCave& floor)
 		str >> newSeed;
 		CaveGenerationInit(inputWidth[0], inputHeight[0], fillPercentage, newSeed);
 	}
-	walls.Delete();
-	ceiling.Delete();
-	floor.Delete();
+	QuantiseInit();
 
-	walls = FlatCave(verticesWalls, wireframeMode[0], std::vector<Texture>() = { Texture("media/textures/rock.jpg", GL_RGB, 1) });
-	ceiling = FlatCave(verticesFloor, wireframeMode[0]);
-	floor = FlatCave(verticesFloor, wireframeMode[0]);
-}
+	ScopedTimer uploadTimer("VBO upload");
+	UploadCave(walls, ceiling);
+	uploadTimer.Stop();
+
+	lodCave.Clear();
+	LodCaveInit(lodCave);
+} // Refills the existing caves' buffers rather than creating new ones.
+
+void SaveMeshButton()
+{
+	if (meshLoaded)
+	{
+		meshFileStatus = "Generate a cave to save";
+		return;
+	}
+
+	CaveGenerator caveGenerator(currentCaveKey.width, currentCaveKey.height, currentCaveKey.fillPercent, currentCaveKey.seed, currentCaveKey.borderSize, true, currentCaveKey.fusedFill != 0);
+	MeshGenerator meshGenerator(caveGenerator.borderedMap, 1, currentCaveKey.greedyMerge != 0, currentCaveKey.simplifyOutlines != 0, currentCaveKey.outlineTolerance, lodChunkSize);
+	std::vector<float> floor = std::vector<float>();
+	std::vector<float> walls = std::vector<float>();
+	meshGenerator.CreateFinalVertexBuffers(floor, walls);
+
+	bool saved = CaveMeshFile::Write(inputMeshPath, floor, walls, meshGenerator.chunks);
+	meshFileStatus = saved ? "Saved" : "Could not save";
+} // Saves the full resolution cave being shown, split into chunks. Its vertices were freed once they were uploaded, so like ExportButton it is generated
+  // again from the same settings. A loaded cave has no settings to generate it from, so nothing is written until a cave is generated.
 
-void Debug(FlatCave& walls, FlatCave& ceiling, FlatCave& floor)
+void LoadMeshButton(FlatCave& walls, FlatCave& ceiling, LodCave& lodCave)
+{
+	CaveMeshFile meshFile;
+	if (!meshFile.Open(inputMeshPath))
+	{
+		meshFileStatus = "Could not load";
+		return;
+	}
+
+	PipelineProfiler::Get().Clear();
+	traceExported = false;
+	quantisedCave = false;
+	lodCave.Clear();
+
+	ScopedTimer uploadTimer("VBO upload");
+	walls.Upload(meshFile.GetWallVertices(), meshFile.GetWallFloatCount());
+	ceiling.Upload(meshFile.GetFloorVertices(), meshFile.GetFloorFloatCount());
+	uploadTimer.Stop();
+	meshLoaded = true;
+	meshFileStatus = "Loaded";
+} // Uploads the vertices straight from the mapped file, they are never copied into vectors.
+
+void ExportButton(const char* extension)
+{
+	if (meshLoaded)
+	{
+		meshFileStatus = "Generate a cave to export";
+		return;
+	}
+
+	CaveGenerator caveGenerator(currentCaveKey.width, currentCaveKey.height, currentCaveKey.fillPercent, currentCaveKey.seed, currentCaveKey.borderSize, true, currentCaveKey.fusedFill != 0);
+	MeshGenerator meshGenerator(caveGenerator.borderedMap, 1, currentCaveKey.greedyMerge != 0, currentCaveKey.simplifyOutlines != 0, currentCaveKey.outlineTolerance, lodChunkSize);
+	MeshExporter exporter(meshGenerator);
+
+	std::string path = std::string("cave.") + extension;
+	bool exported = false;
+	if (strcmp(extension, "obj") == 0)
+	{
+		exported = exporter.WriteObj(path);
+	}
+	else if (strcmp(extension, "ply") == 0)
+	{
+		exported = exporter.WritePly(path);
+	}
+	else
+	{
+		exported = exporter.WriteGlb(path);
+	}
+	meshFileStatus = exported ? "Exported " + path : "Could not export";
+} // The shown cave's vertex buffers are only what is needed to draw it, so the mesh is generated again from the same settings and streamed out of the generator.
+
+void Debug(FlatCave& walls, FlatCave& ceiling, LodCave& lodCave)
 {
 	ImGui::Begin("Debug");
 	ImGui::Text("FPS: %.1f", ImGui::GetIO().Framerate);
-	ImGui::Text("Current Seed: %d", currentSeed);
+	ImGui::Text("Current Seed: %d%s%s", currentSeed, loadedFromCache ? " (cached)" : "", quantisedCave ? " (quantised)" : "");
 	if (ImGui::Checkbox("Wireframe", wireframeMode))
 	{
 		walls.wireFrame = wireframeMode[0];
 		ceiling.wireFrame = wireframeMode[0];
-		floor.wireFrame = wireframeMode[0];
+		lodCave.SetWireFrame(wireframeMode[0]);
 	}
 	ImGui::Checkbox("Flat mode", flatMode);
+	ImGui::Checkbox("Greedy merge", greedyMergeMode);
+	ImGui::Checkbox("Simplify walls", simplifyWallsMode);
+	ImGui::Checkbox("Level of detail", lodMode);
+	ImGui::Checkbox("Use cache", cacheMode);
+	ImGui::Checkbox("Quantise vertices", quantiseMode);
+	ImGui::Checkbox("Tiled smoothing", tiledSmoothingMode);
+	ImGui::Checkbox("Fused fill", fusedFillMode);
 	ImGui::InputInt("X Width ", inputWidth);
 	ImGui::InputInt("Z Width ", inputHeight);
 	ImGui::InputFloat("Fill Percentage ", inputFillPercentage, 0.01f, 0.01f, 2);
+	ImGui::InputFloat("Wall Tolerance ", inputWallTolerance, 0.05f, 0.05f, 2);
+	ImGui::InputFloat("LOD Distance ", inputLodDistance, 5.0f, 5.0f, 1);
 	ImGui::InputText("Seed ", inputSeed, 11); ImGui::SameLine();
 	if (ImGui::Button("Reset"))
 	{
@@ -197,15 +481,77 @@ void Debug(FlatCave& walls, FlatCave& ceiling, FlatCave& floor)
 	}
 	if (ImGui::Button("Generate Cave"))
 	{
-		GenerateButton(walls, ceiling, floor);
+		GenerateButton(walls, ceiling, lodCave);
+	}
+	ImGui::InputText("Mesh File ", inputMeshPath, 128);
+	if (ImGui::Button("Save Mesh"))
+	{
+		SaveMeshButton();
 	}
+	ImGui::SameLine();
+	if (ImGui::Button("Load Mesh"))
+	{
+		LoadMeshButton(walls, ceiling, lodCave);
+	}
+	ImGui::SameLine();
+	ImGui::Text("%s", meshFileStatus.c_str());
+	if (ImGui::Button("Export OBJ"))
+	{
+		ExportButton("obj");
+	}
+	ImGui::SameLine();
+	if (ImGui::Button("Export PLY"))
+	{
+		ExportButton("ply");
+	}
+	ImGui::SameLine();
+	if (ImGui::Button("Export GLB"))
+	{
+		ExportButton("glb");
+	}
+	RenderStateCounts& glCounts = RenderState::Get().lastFrameCounts;
+	ImGui::Text("GL calls: %u, %u skipped, textures loaded: %u", glCounts.GetTotalCalls(), glCounts.skippedCalls, TextureCache::Get().loads);
+	ImGui::Text("Vertex buffers: %.1f KB", (walls.bufferCapacity + ceiling.bufferCapacity + lodCave.GetBufferBytes()) / 1024.0);
+	ImGui::Text("Draws %u, programs %u, arrays %u, textures %u, modes %u", glCounts.drawCalls, glCounts.programChanges, glCounts.vertexArrayBinds,
+		glCounts.textureBinds, glCounts.polygonModeChanges);
 	ImGui::Text("Press ` or F1 to toggle to debug menu");
 	ImGui::Text("Press ESC to exit");
 	ImGui::SetWindowPos(ImVec2(0, 0));
-	ImGui::SetWindowSize(ImVec2(400, 260));
+	ImGui::SetWindowSize(ImVec2(400, 599));
 	ImGui::End();
 }
 
+void PipelineStats()
+{
+	PipelineProfiler& profiler = PipelineProfiler::Get();
+
+	ImGui::Begin("Pipeline");
+	ImGui::Text("Total: %.3f ms", profiler.GetTotalMilliseconds());
+	ImGui::Separator();
+	for (unsigned int i = 0; i < profiler.samples.size(); i++)
+	{
+		ImGui::Text("%-24s %10.3f ms", profiler.samples[i].name.c_str(), profiler.samples[i].durationMicroseconds / 1000.0);
+	}
+	ImGui::Separator();
+	for (unsigned int i = 0; i < profiler.counts.size(); i++)
+	{
+		ImGui::Text("%-24s %10zu", profiler.counts[i].name.c_str(), profiler.counts[i].value);
+	}
+	ImGui::Separator();
+	if (ImGui::Button("Export Trace"))
+	{
+		traceExported = profiler.ExportChromeTrace("pipeline_trace.json");
+	}
+	if (traceExported)
+	{
+		ImGui::SameLine();
+		ImGui::Text("Saved to pipeline_trace.json");
+	}
+	ImGui::SetWindowPos(ImVec2(0, 599));
+	ImGui::SetWindowSize(ImVec2(400, 301));
+	ImGui::End();
+} // Shows how long each stage of the last generation took and how much it produced. The trace can be opened in chrome://tracing or Perfetto.
+
 void MouseCallback(GLFWwindow* window, double xpos, double ypos) 
 {
 	camera.MouseCallback(xpos, ypos);
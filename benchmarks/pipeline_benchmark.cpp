@@ -0,0 +1,408 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+#include "../generation/cave_generator.h"
+#include "../generation/mesh_generator.h"
+#include "../generation/mesh_exporter.h"
+#include "../generation/grid_serializer.h"
+
+// Headless benchmark of the generation pipeline, nothing here needs a window or an OpenGL context.
+// Prints one CSV row per map size and fill percentage to stdout so results can be collected and compared between builds.
+// With --verify it instead checks that the faster generation paths give exactly the same caves and meshes as the plain ones, and exits with 1 if any differ.
+
+struct BenchmarkResult
+{
+	double caveMilliseconds;
+	double gridCopyMilliseconds; // One deep copy of the bordered map, which the mesh stages no longer make.
+	double squareGridMilliseconds;
+	double meshMilliseconds;
+	double finalVerticesMilliseconds;
+	double gridDecodeMilliseconds;
+	size_t gridBytes;
+	size_t triangles;
+	size_t wallTriangles;
+	double exportMegabytesPerSecond[3]; // OBJ, PLY, and GLB, left at 0 unless exporting.
+};
+
+std::vector<int> sizes = { 64, 128, 256, 512 };
+std::vector<int> fillPercentages = { 40, 45, 50 };
+int repeats = 3;
+int seed = 1;
+bool greedyMerge = false;
+bool simplifyOutlines = false;
+bool tiledSmoothing = false;
+bool fusedFill = false;
+bool verify = false;
+std::string exportDirectory = "";
+
+void ParseArguments(int argc, char** argv);
+std::vector<int> ParseList(const char* text);
+BenchmarkResult RunPipeline(int size, int fillPercentage);
+bool VerifyExactness();
+bool MatchesPerSquareMesh(const std::vector<std::vector<int>>& map);
+void TriangulateReferenceSquare(MeshGenerator& reference, Square& square, int configuration);
+void MeshFromReferencePoints(MeshGenerator& reference, std::vector<Node> points);
+double MillisecondsSince(std::chrono::steady_clock::time_point start);
+size_t PeakMemoryBytes();
+
+int main(int argc, char** argv)
+{
+	ParseArguments(argc, argv);
+	if (verify)
+	{
+		return VerifyExactness() ? 0 : 1;
+	}
+
+	std::cout << "width,height,fill_percent,seed,greedy_merge,simplify_outlines,cave_ms,grid_copy_ms,square_grid_ms,mesh_ms,final_vertices_ms,total_ms,"
+		<< "cells_per_second,grid_bytes,grid_decode_ms,triangles,wall_triangles,triangles_per_second,obj_mb_per_second,ply_mb_per_second,glb_mb_per_second,peak_memory_bytes" << std::endl;
+
+	for (unsigned int i = 0; i < sizes.size(); i++)
+	{
+		for (unsigned int j = 0; j < fillPercentages.size(); j++)
+		{
+			BenchmarkResult best = RunPipeline(sizes[i], fillPercentages[j]);
+			for (int repeat = 1; repeat < repeats; repeat++)
+			{
+				BenchmarkResult result = RunPipeline(sizes[i], fillPercentages[j]);
+				best.caveMilliseconds = std::min(best.caveMilliseconds, result.caveMilliseconds);
+				best.gridCopyMilliseconds = std::min(best.gridCopyMilliseconds, result.gridCopyMilliseconds);
+				best.squareGridMilliseconds = std::min(best.squareGridMilliseconds, result.squareGridMilliseconds);
+				best.meshMilliseconds = std::min(best.meshMilliseconds, result.meshMilliseconds);
+				best.finalVerticesMilliseconds = std::min(best.finalVerticesMilliseconds, result.finalVerticesMilliseconds);
+				best.gridDecodeMilliseconds = std::min(best.gridDecodeMilliseconds, result.gridDecodeMilliseconds);
+				for (int format = 0; format < 3; format++)
+				{
+					best.exportMegabytesPerSecond[format] = std::max(best.exportMegabytesPerSecond[format], result.exportMegabytesPerSecond[format]);
+				}
+			}
+
+			double totalMilliseconds = best.caveMilliseconds + best.meshMilliseconds + best.finalVerticesMilliseconds;
+			double cellsPerSecond = double(sizes[i]) * sizes[i] / (best.caveMilliseconds / 1000.0);
+			double trianglesPerSecond = double(best.triangles + best.wallTriangles) / ((best.meshMilliseconds + best.finalVerticesMilliseconds) / 1000.0);
+
+			std::cout << sizes[i] << "," << sizes[i] << "," << fillPercentages[j] << "," << seed << "," << greedyMerge << "," << simplifyOutlines << ","
+				<< best.caveMilliseconds << "," << best.gridCopyMilliseconds << "," << best.squareGridMilliseconds << "," << best.meshMilliseconds << "," << best.finalVerticesMilliseconds << "," << totalMilliseconds << ","
+				<< cellsPerSecond << "," << best.gridBytes << "," << best.gridDecodeMilliseconds << "," << best.triangles << "," << best.wallTriangles << "," << trianglesPerSecond << ","
+				<< best.exportMegabytesPerSecond[0] << "," << best.exportMegabytesPerSecond[1] << "," << best.exportMegabytesPerSecond[2] << "," << PeakMemoryBytes() << std::endl;
+		}
+	}
+
+	return 0;
+}
+
+void ParseArguments(int argc, char** argv)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--sizes") == 0 && i + 1 < argc)
+		{
+			sizes = ParseList(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--fills") == 0 && i + 1 < argc)
+		{
+			fillPercentages = ParseList(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--repeats") == 0 && i + 1 < argc)
+		{
+			repeats = std::max(atoi(argv[++i]), 1);
+		}
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+		{
+			seed = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--greedy") == 0)
+		{
+			greedyMerge = true;
+		}
+		else if (strcmp(argv[i], "--simplify") == 0)
+		{
+			simplifyOutlines = true;
+		}
+		else if (strcmp(argv[i], "--tiled") == 0)
+		{
+			tiledSmoothing = true;
+		}
+		else if (strcmp(argv[i], "--fused") == 0)
+		{
+			fusedFill = true;
+		}
+		else if (strcmp(argv[i], "--verify") == 0)
+		{
+			verify = true;
+		}
+		else if (strcmp(argv[i], "--export") == 0 && i + 1 < argc)
+		{
+			exportDirectory = argv[++i];
+		}
+		else
+		{
+			std::cerr << "Usage: " << argv[0] << " [--sizes 64,128] [--fills 40,45] [--repeats 3] [--seed 1] [--greedy] [--simplify] [--tiled] [--fused] [--verify] [--export directory]" << std::endl;
+			exit(1);
+		}
+	}
+} // Reads the sweep from the command line, anything left out keeps its default.
+
+std::vector<int> ParseList(const char* text)
+{
+	std::vector<int> values = std::vector<int>();
+	std::stringstream stream(text);
+	std::string value;
+	while (std::getline(stream, value, ','))
+	{
+		values.push_back(atoi(value.c_str()));
+	}
+	return values;
+} // Splits a comma separated list of integers.
+
+BenchmarkResult RunPipeline(int size, int fillPercentage)
+{
+	BenchmarkResult result = BenchmarkResult();
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	CaveGenerator caveGenerator(size, size, fillPercentage, seed, 5, tiledSmoothing, fusedFill);
+	result.caveMilliseconds = MillisecondsSince(start);
+
+	std::vector<uint8_t> encodedMap = GridSerializer::Encode(caveGenerator.borderedMap, caveGenerator.borderSize);
+	std::vector<std::vector<int>> decodedMap = std::vector<std::vector<int>>();
+	start = std::chrono::steady_clock::now();
+	GridSerializer::Decode(encodedMap, decodedMap);
+	result.gridDecodeMilliseconds = MillisecondsSince(start);
+	result.gridBytes = encodedMap.size();
+
+	start = std::chrono::steady_clock::now();
+	std::vector<std::vector<int>> copiedMap = caveGenerator.borderedMap;
+	result.gridCopyMilliseconds = MillisecondsSince(start);
+
+	start = std::chrono::steady_clock::now();
+	SquareGrid squareGrid(caveGenerator.borderedMap, 1);
+	result.squareGridMilliseconds = MillisecondsSince(start);
+
+	start = std::chrono::steady_clock::now();
+	MeshGenerator meshGenerator(caveGenerator.borderedMap, 1, greedyMerge, simplifyOutlines);
+	result.meshMilliseconds = MillisecondsSince(start);
+
+	std::vector<float> verticesFloor = std::vector<float>();
+	std::vector<float> verticesWalls = std::vector<float>();
+	start = std::chrono::steady_clock::now();
+	meshGenerator.CreateFinalVertexBuffers(verticesFloor, verticesWalls);
+	result.finalVerticesMilliseconds = MillisecondsSince(start);
+
+	result.triangles = verticesFloor.size() / (MeshGenerator::floorVertexFloats * 3);
+	result.wallTriangles = verticesWalls.size() / (MeshGenerator::wallVertexFloats * 3);
+
+	if (!exportDirectory.empty())
+	{
+		MeshExporter exporter(meshGenerator);
+		std::string path = exportDirectory + "/cave_" + std::to_string(size) + "_" + std::to_string(fillPercentage);
+		for (int format = 0; format < 3; format++)
+		{
+			start = std::chrono::steady_clock::now();
+			bool written = format == 0 ? exporter.WriteObj(path + ".obj") : format == 1 ? exporter.WritePly(path + ".ply") : exporter.WriteGlb(path + ".glb");
+			double milliseconds = MillisecondsSince(start);
+			result.exportMegabytesPerSecond[format] = written ? exporter.bytesWritten / 1000000.0 / (milliseconds / 1000.0) : 0.0;
+		}
+	}
+	return result;
+} // Runs every stage once. The square grid is also timed on its own, the mesh time includes building it again inside MeshGenerator. The map is handed to both
+  // by reference, the copy is timed separately to show what passing it by value used to add twice per cave. When an export directory is given the mesh is
+  // also written in every export format.
+
+bool VerifyExactness()
+{
+	const int borderSizes[] = { 1, 5 };
+	int caves = 0;
+	int mismatches = 0;
+	for (unsigned int i = 0; i < sizes.size(); i++)
+	{
+		for (unsigned int j = 0; j < fillPercentages.size(); j++)
+		{
+			for (int caveSeed = seed; caveSeed < seed + 2; caveSeed++)
+			{
+				for (int border = 0; border < 2; border++)
+				{
+					int width = sizes[i];
+					int height = sizes[i] + 13;
+					std::string cave = std::to_string(width) + "x" + std::to_string(height) + " fill " + std::to_string(fillPercentages[j]) + " seed " + std::to_string(caveSeed)
+						+ " border " + std::to_string(borderSizes[border]);
+
+					CaveGenerator plain(width, height, fillPercentages[j], caveSeed, borderSizes[border], false, false);
+					CaveGenerator tiled(width, height, fillPercentages[j], caveSeed, borderSizes[border], true, false);
+					if (tiled.borderedMap != plain.borderedMap)
+					{
+						std::cerr << "Tiled smoothing differs from plain smoothing: " << cave << std::endl;
+						mismatches++;
+					}
+
+					CaveGenerator fused(width, height, fillPercentages[j], caveSeed, borderSizes[border], false, true);
+					CaveGenerator fusedTiled(width, height, fillPercentages[j], caveSeed, borderSizes[border], true, true);
+					if (fusedTiled.borderedMap != fused.borderedMap)
+					{
+						std::cerr << "Tiled smoothing differs from plain smoothing with the fused fill: " << cave << std::endl;
+						mismatches++;
+					}
+
+					if (!MatchesPerSquareMesh(plain.borderedMap))
+					{
+						std::cerr << "Packed configurations do not mesh the same as each square on its own: " << cave << std::endl;
+						mismatches++;
+					}
+					caves++;
+				}
+			}
+		}
+	}
+	std::cout << "Verified " << caves << " caves, " << mismatches << " mismatches" << std::endl;
+	return mismatches == 0;
+} // Every size is run with a height 13 larger so neither side lines up with the smoothing tiles or the 8 by 8 blocks, and with two seeds and two border sizes.
+
+bool MatchesPerSquareMesh(const std::vector<std::vector<int>>& map)
+{
+	MeshGenerator meshGenerator(map, 1);
+
+	MeshGenerator reference(map, 1);
+	reference.vertices = std::vector<glm::vec3>();
+	reference.triangles = std::vector<int>();
+	reference.triangleDictionary = std::map<int, std::vector<Triangle>>();
+	reference.outlines = std::vector<std::vector<int>>();
+	reference.checkedVertices = std::unordered_set<int>();
+	reference.outlineCandidates = std::vector<int>();
+	std::fill(reference.nodeVertexIndices.begin(), reference.nodeVertexIndices.end(), -1);
+	for (int x = 0; x < reference.GetSquareCountX(); x++)
+	{
+		for (int y = 0; y < reference.GetSquareCountY(); y++)
+		{
+			Square square = reference.squareGrid.GetSquare(x, y);
+			int configuration = (square.topLeft.active ? 8 : 0) + (square.topRight.active ? 4 : 0) + (square.bottomRight.active ? 2 : 0) + (square.bottomLeft.active ? 1 : 0);
+			if (configuration != meshGenerator.GetConfiguration(x, y))
+			{
+				return false;
+			}
+			TriangulateReferenceSquare(reference, square, configuration);
+		}
+	}
+	for (unsigned int i = 0; i < reference.vertices.size(); i++)
+	{
+		reference.outlineCandidates.push_back(i);
+	}
+	reference.CreateWallMesh();
+
+	std::vector<float> verticesFloor = std::vector<float>();
+	std::vector<float> verticesWalls = std::vector<float>();
+	meshGenerator.CreateFinalVertexBuffers(verticesFloor, verticesWalls);
+	std::vector<float> referenceFloor = std::vector<float>();
+	std::vector<float> referenceWalls = std::vector<float>();
+	reference.CreateFinalVertexBuffers(referenceFloor, referenceWalls);
+	return verticesFloor == referenceFloor && verticesWalls == referenceWalls;
+} // Meshes the map again the way it was done before configurations were packed into bits, one Square at a time using the configuration worked out from its
+  // own corners, without skipping uniform blocks and without the case tables. Every vertex is an outline candidate, so the outlines are searched for from
+  // every vertex rather than only those in mixed blocks. Both the configurations and the final vertex buffers must match exactly.
+
+void TriangulateReferenceSquare(MeshGenerator& reference, Square& square, int configuration)
+{
+	switch (configuration)
+	{
+	case 1:
+		MeshFromReferencePoints(reference, { square.centerLeft, square.centerBottom, square.bottomLeft });
+		break;
+	case 2:
+		MeshFromReferencePoints(reference, { square.bottomRight, square.centerBottom, square.centerRight });
+		break;
+	case 4:
+		MeshFromReferencePoints(reference, { square.topRight, square.centerRight, square.centerTop });
+		break;
+	case 8:
+		MeshFromReferencePoints(reference, { square.topLeft, square.centerTop, square.centerLeft });
+		break;
+	case 3:
+		MeshFromReferencePoints(reference, { square.centerRight, square.bottomRight, square.bottomLeft, square.centerLeft });
+		break;
+	case 6:
+		MeshFromReferencePoints(reference, { square.centerTop, square.topRight, square.bottomRight, square.centerBottom });
+		break;
+	case 9:
+		MeshFromReferencePoints(reference, { square.topLeft, square.centerTop, square.centerBottom, square.bottomLeft });
+		break;
+	case 12:
+		MeshFromReferencePoints(reference, { square.topLeft, square.topRight, square.centerRight, square.centerLeft });
+		break;
+	case 5:
+		MeshFromReferencePoints(reference, { square.centerTop, square.topRight, square.centerRight, square.centerBottom, square.bottomLeft, square.centerLeft });
+		break;
+	case 10:
+		MeshFromReferencePoints(reference, { square.topLeft, square.centerTop, square.centerRight, square.bottomRight, square.centerBottom, square.centerLeft });
+		break;
+	case 7:
+		MeshFromReferencePoints(reference, { square.centerTop, square.topRight, square.bottomRight, square.bottomLeft, square.centerLeft });
+		break;
+	case 11:
+		MeshFromReferencePoints(reference, { square.topLeft, square.centerTop, square.centerRight, square.bottomRight, square.bottomLeft });
+		break;
+	case 13:
+		MeshFromReferencePoints(reference, { square.topLeft, square.topRight, square.centerRight, square.centerBottom, square.bottomLeft });
+		break;
+	case 14:
+		MeshFromReferencePoints(reference, { square.topLeft, square.topRight, square.bottomRight, square.centerBottom, square.centerLeft });
+		break;
+	case 15:
+	{
+		std::vector<Node> points = { square.topLeft, square.topRight, square.bottomRight, square.bottomLeft };
+		reference.AssignVertices(points);
+		reference.CreateTriangle(points[0], points[1], points[2]);
+		reference.CreateTriangle(points[0], points[2], points[3]);
+		for (unsigned int i = 0; i < points.size(); i++)
+		{
+			reference.checkedVertices.insert(points[i].vertexIndex);
+		}
+		break;
+	}
+	}
+} // The switch MeshGenerator used before its case tables, written out case by case. A fully active square has no walls so its corners are marked as checked.
+
+void MeshFromReferencePoints(MeshGenerator& reference, std::vector<Node> points)
+{
+	reference.AssignVertices(points);
+	for (unsigned int i = 2; i < points.size(); i++)
+	{
+		reference.CreateTriangle(points[0], points[i - 1], points[i]);
+	}
+} // Fans the shape from its first point.
+
+double MillisecondsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+size_t PeakMemoryBytes()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+	{
+		return counters.PeakWorkingSetSize;
+	}
+	return 0;
+#else
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+	return usage.ru_maxrss;
+#else
+	return size_t(usage.ru_maxrss) * 1024;
+#endif
+#endif
+} // Peak resident memory of the whole process so far. Sizes are swept from smallest to largest so each row shows the peak up to that run.
@@ -0,0 +1,47 @@
+#ifndef DIB_CLASS_H
+#define DIB_CLASS_H
+
+#include <GL/glew.h>
+#include <vector>
+
+struct DrawArraysIndirectCommand
+{
+	GLuint count;
+	GLuint instanceCount;
+	GLuint first;
+	GLuint baseInstance;
+}; // Laid out as glMultiDrawArraysIndirect reads it.
+
+class DIB
+{
+public:
+	GLuint ID;
+
+	DIB()
+	{
+		glGenBuffers(1, &ID);
+	}
+
+	void Update(const std::vector<DrawArraysIndirectCommand>& commands)
+	{
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, ID);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawArraysIndirectCommand), commands.data(), GL_STREAM_DRAW);
+	} // Replaces the whole buffer, the driver hands back fresh memory rather than waiting for last frame's draws to finish with the old commands.
+
+	void Bind()
+	{
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, ID);
+	}
+
+	void Unbind()
+	{
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+
+	void Delete()
+	{
+		glDeleteBuffers(1, &ID);
+	}
+}; // Draw indirect buffer, holds the draw commands for glMultiDrawArraysIndirect.
+
+#endif
\ No newline at end of file
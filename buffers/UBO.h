@@ -0,0 +1,45 @@
+#ifndef UBO_CLASS_H
+#define UBO_CLASS_H
+
+#include <GL/glew.h>
+
+class UBO
+{
+public:
+	GLuint ID;
+	GLuint bindingPoint;
+
+	UBO(GLsizeiptr size, GLuint bindingPoint)
+	{
+		UBO::bindingPoint = bindingPoint;
+		glGenBuffers(1, &ID);
+		glBindBuffer(GL_UNIFORM_BUFFER, ID);
+		glBufferData(GL_UNIFORM_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
+		glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, ID);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	} // Buffer for a uniform block shared by several shaders, each shader links its block to the same binding point with Shader::BindUniformBlock.
+
+	void Update(const void* data, GLsizeiptr size, GLintptr offset = 0)
+	{
+		glBindBuffer(GL_UNIFORM_BUFFER, ID);
+		glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+
+	void Bind()
+	{
+		glBindBuffer(GL_UNIFORM_BUFFER, ID);
+	}
+
+	void Unbind()
+	{
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+
+	void Delete()
+	{
+		glDeleteBuffers(1, &ID);
+	}
+};
+
+#endif
\ No newline at end of file
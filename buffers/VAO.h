@@ -3,6 +3,7 @@
 
 #include <GL/glew.h>
 #include "VBO.h"
+#include "../render_state.h"
 
 class VAO
 {
@@ -22,19 +23,24 @@ public:
 		VBO.Unbind();
 	}
 
+	void DisableAttrib(GLuint layout)
+	{
+		glDisableVertexAttribArray(layout);
+	} // For when the vertex array is bound and a buffer with fewer attributes replaces the old one.
+
 	void Bind()
 	{
-		glBindVertexArray(ID);
+		RenderState::Get().BindVertexArray(ID);
 	}
 
 	void Unbind()
 	{
-		glBindVertexArray(0);
+		RenderState::Get().BindVertexArray(0);
 	}
 
 	void Delete()
 	{
-		glDeleteVertexArrays(1, &ID);
+		RenderState::Get().DeleteVertexArray(ID);
 	}
 };
 
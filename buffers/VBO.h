@@ -10,6 +10,11 @@ class VBO
 public:
 	GLuint ID;
 
+	VBO()
+	{
+		glGenBuffers(1, &ID);
+	} // Buffer with no storage yet, for one that is filled and refilled by its owner.
+
 	VBO(std::vector<GLfloat> vertices)
 	{
 		glGenBuffers(1, &ID);
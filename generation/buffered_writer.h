@@ -0,0 +1,188 @@
+#ifndef BUFFERED_WRITER_CLASS
+#define BUFFERED_WRITER_CLASS
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdarg>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Writes a file through one fixed size buffer, so output can be produced a few bytes at a time without a system call for each and without ever holding more
+// than the buffer in memory.
+
+class BufferedWriter
+{
+public:
+	size_t bytesWritten;
+
+	BufferedWriter(size_t bufferSize = 1 << 20)
+	{
+		BufferedWriter::file = nullptr;
+		BufferedWriter::buffer = std::vector<char>(bufferSize);
+		BufferedWriter::used = 0;
+		BufferedWriter::bytesWritten = 0;
+		BufferedWriter::failed = false;
+	}
+
+	BufferedWriter(const BufferedWriter&) = delete;
+	BufferedWriter& operator=(const BufferedWriter&) = delete;
+
+	~BufferedWriter()
+	{
+		Close();
+	}
+
+	bool Open(const std::string& path)
+	{
+		Close();
+		file = fopen(path.c_str(), "wb");
+		used = 0;
+		bytesWritten = 0;
+		failed = file == nullptr;
+		return !failed;
+	}
+
+	bool Close()
+	{
+		if (file == nullptr)
+		{
+			return false;
+		}
+		Flush();
+		failed |= fclose(file) != 0;
+		file = nullptr;
+		return !failed;
+	} // Returns false if anything written since the file was opened failed to reach it.
+
+	void Write(const void* data, size_t size)
+	{
+		if (file == nullptr)
+		{
+			failed = true;
+			return;
+		}
+		if (used + size > buffer.size())
+		{
+			Flush();
+			if (size > buffer.size())
+			{
+				failed |= fwrite(data, 1, size, file) != size;
+				bytesWritten += size;
+				return;
+			}
+		}
+		memcpy(buffer.data() + used, data, size);
+		used += size;
+		bytesWritten += size;
+	}
+
+	template <typename T>
+	void WriteValue(T value)
+	{
+		Write(&value, sizeof(T));
+	} // Writes the raw bytes of a value, so numbers come out in the machine's byte order.
+
+	void WriteText(const char* text)
+	{
+		Write(text, strlen(text));
+	}
+
+	void WriteFormat(const char* format, ...)
+	{
+		static const size_t longestLine = 256;
+		if (file == nullptr)
+		{
+			failed = true;
+			return;
+		}
+		if (used + longestLine > buffer.size())
+		{
+			Flush();
+		}
+
+		va_list arguments;
+		va_start(arguments, format);
+		int length = vsnprintf(buffer.data() + used, buffer.size() - used, format, arguments);
+		va_end(arguments);
+		if (length < 0 || size_t(length) >= buffer.size() - used)
+		{
+			failed = true;
+			return;
+		}
+		used += length;
+		bytesWritten += length;
+	} // printf straight into the buffer. Meant for short lines, anything that does not fit in the space left marks the file as failed.
+
+	void WriteUnsigned(uint64_t value)
+	{
+		char digits[20];
+		int count = 0;
+		do
+		{
+			digits[19 - count++] = char('0' + value % 10);
+			value /= 10;
+		} while (value != 0);
+		Write(digits + 20 - count, count);
+	} // Writes a number as decimal text, much quicker than going through printf for the many indices of a text mesh.
+
+	void WriteDecimal(double value, int decimals = 4)
+	{
+		static const uint64_t scales[] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+		uint64_t scale = scales[decimals];
+		uint64_t scaled = uint64_t((value < 0.0 ? -value : value) * scale + 0.5);
+		if (value < 0.0 && scaled != 0)
+		{
+			Write("-", 1);
+		}
+		WriteUnsigned(scaled / scale);
+
+		uint64_t fraction = scaled % scale;
+		if (fraction != 0)
+		{
+			char digits[8];
+			digits[0] = '.';
+			int count = decimals;
+			for (int i = decimals; i > 0; i--)
+			{
+				digits[i] = char('0' + fraction % 10);
+				fraction /= 10;
+			}
+			while (digits[count] == '0')
+			{
+				count--;
+			}
+			Write(digits, count + 1);
+		}
+	} // Writes a number rounded to a fixed number of decimal places, at most 6, without trailing zeros.
+
+	void WritePadding(size_t count, char value)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			Write(&value, 1);
+		}
+	}
+
+private:
+	FILE* file;
+	std::vector<char> buffer;
+	size_t used;
+	bool failed;
+
+	void Flush()
+	{
+		if (file == nullptr)
+		{
+			failed = true;
+			used = 0;
+		}
+		else if (used > 0)
+		{
+			failed |= fwrite(buffer.data(), 1, used, file) != used;
+			used = 0;
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,220 @@
+#ifndef CAVE_CACHE_CLASS
+#define CAVE_CACHE_CLASS
+
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <fstream>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include "cave_generator.h"
+#include "grid_serializer.h"
+#include "pipeline_profiler.h"
+
+// Caches generated caves on disk so a cave that has been seen before is read back rather than generated again. Each file is named after a hash of everything that
+// decides what the cave looks like, and holds the bordered map encoded by GridSerializer along with the final floor and wall vertex buffers.
+
+struct CaveCacheKey
+{
+	int32_t width;
+	int32_t height;
+	int32_t fillPercent;
+	int32_t seed;
+	int32_t borderSize;
+	int32_t smoothPasses;
+	int32_t wallThreshold;
+	int32_t greedyMerge;
+	int32_t simplifyOutlines;
+	float outlineTolerance;
+	int32_t fusedFill;
+	uint32_t algorithmVersion;
+
+	CaveCacheKey()
+	{
+		memset(this, 0, sizeof(CaveCacheKey));
+	} // Every field is four bytes so there is no padding, the key can be hashed and compared as raw bytes.
+};
+
+class CaveCache
+{
+public:
+	std::string directory;
+
+	static const uint32_t algorithmVersion = 1; // Bump whenever a change to the generation code changes its output, every older file is then ignored.
+	static const uint32_t fileVersion = 3;
+
+	CaveCache(std::string directory = "cache")
+	{
+		CaveCache::directory = directory;
+	}
+
+	static CaveCacheKey MakeKey(int width, int height, int fillPercent, int seed, int borderSize, bool greedyMerge, bool simplifyOutlines, float outlineTolerance, bool fusedFill = false)
+	{
+		CaveCacheKey key = CaveCacheKey();
+		key.width = width;
+		key.height = height;
+		key.fillPercent = fillPercent;
+		key.seed = seed;
+		key.borderSize = borderSize;
+		key.smoothPasses = CaveGenerator::smoothPasses;
+		key.wallThreshold = CaveGenerator::wallThreshold;
+		key.greedyMerge = greedyMerge ? 1 : 0;
+		key.simplifyOutlines = simplifyOutlines ? 1 : 0;
+		key.outlineTolerance = simplifyOutlines ? outlineTolerance : 0.0f;
+		key.fusedFill = fusedFill ? 1 : 0;
+		key.algorithmVersion = algorithmVersion;
+		return key;
+	} // The tolerance only matters when outlines are simplified, so it is left out of the key otherwise.
+
+	std::string GetPath(const CaveCacheKey& key)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		const unsigned char* bytes = (const unsigned char*)&key;
+		for (unsigned int i = 0; i < sizeof(CaveCacheKey); i++)
+		{
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+		}
+
+		char name[32];
+		snprintf(name, sizeof(name), "%016llx.cave", (unsigned long long)hash);
+		return directory + "/" + name;
+	} // FNV-1a hash of the key.
+
+	bool Load(const CaveCacheKey& key, std::vector<std::vector<int>>& borderedMap, std::vector<float>& verticesFloor, std::vector<float>& verticesWalls)
+	{
+		ScopedTimer timer("Cache load");
+
+		std::ifstream file(GetPath(key), std::ios::binary);
+		if (!file.is_open())
+		{
+			return false;
+		}
+
+		char magic[4];
+		uint32_t version = 0;
+		CaveCacheKey storedKey = CaveCacheKey();
+		file.read(magic, sizeof(magic));
+		file.read((char*)&version, sizeof(version));
+		file.read((char*)&storedKey, sizeof(storedKey));
+		if (!file || memcmp(magic, "CAVC", 4) != 0 || version != fileVersion || memcmp(&storedKey, &key, sizeof(CaveCacheKey)) != 0)
+		{
+			return false;
+		}
+
+		uint32_t gridBytes = 0;
+		file.read((char*)&gridBytes, sizeof(gridBytes));
+		if (!file || gridBytes > GetBytesLeft(file))
+		{
+			return false;
+		}
+		std::vector<uint8_t> encodedMap = std::vector<uint8_t>(gridBytes);
+		file.read((char*)encodedMap.data(), encodedMap.size());
+
+		std::vector<float> floor = std::vector<float>();
+		std::vector<float> walls = std::vector<float>();
+		if (!file || !ReadFloats(file, floor) || !ReadFloats(file, walls))
+		{
+			return false;
+		}
+
+		std::vector<std::vector<int>> map = std::vector<std::vector<int>>();
+		if (!GridSerializer::Decode(encodedMap, map, key.width + key.borderSize * 2, key.height + key.borderSize * 2))
+		{
+			return false;
+		}
+		borderedMap.swap(map);
+		verticesFloor.swap(floor);
+		verticesWalls.swap(walls);
+		return true;
+	} // Fills the map and vertex buffers from the cache and returns true, or leaves them untouched and returns false if the cave has not been stored or the
+	  // file does not match the key.
+
+	bool Store(const CaveCacheKey& key, std::vector<std::vector<int>>& borderedMap, std::vector<float>& verticesFloor, std::vector<float>& verticesWalls)
+	{
+		ScopedTimer timer("Cache store");
+		MakeDirectory();
+
+		std::vector<uint8_t> encodedMap = GridSerializer::Encode(borderedMap, key.borderSize);
+		uint32_t gridBytes = encodedMap.size();
+
+		std::string path = GetPath(key);
+		std::string temporaryPath = path + ".tmp";
+		{
+			std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+			if (!file.is_open())
+			{
+				return false;
+			}
+
+			uint32_t version = fileVersion;
+			file.write("CAVC", 4);
+			file.write((const char*)&version, sizeof(version));
+			file.write((const char*)&key, sizeof(key));
+			file.write((const char*)&gridBytes, sizeof(gridBytes));
+			file.write((const char*)encodedMap.data(), encodedMap.size());
+			WriteFloats(file, verticesFloor);
+			WriteFloats(file, verticesWalls);
+			if (!file)
+			{
+				file.close();
+				remove(temporaryPath.c_str());
+				return false;
+			}
+		}
+
+		remove(path.c_str());
+		return rename(temporaryPath.c_str(), path.c_str()) == 0;
+	} // Written to a temporary file first and renamed into place, so an interrupted write never leaves a half finished file under the real name.
+
+private:
+	void MakeDirectory()
+	{
+#ifdef _WIN32
+		_mkdir(directory.c_str());
+#else
+		mkdir(directory.c_str(), 0755);
+#endif
+	} // Fails quietly when the directory already exists.
+
+	bool ReadFloats(std::ifstream& file, std::vector<float>& values)
+	{
+		uint64_t count = 0;
+		file.read((char*)&count, sizeof(count));
+		if (!file || count > GetBytesLeft(file) / sizeof(float))
+		{
+			return false;
+		}
+		values = std::vector<float>(size_t(count));
+		file.read((char*)values.data(), count * sizeof(float));
+		return bool(file);
+	} // A length longer than the rest of the file is treated as a miss before anything is allocated for it.
+
+	uint64_t GetBytesLeft(std::ifstream& file)
+	{
+		std::streampos position = file.tellg();
+		file.seekg(0, std::ios::end);
+		std::streampos end = file.tellg();
+		file.seekg(position);
+		if (!file || position < 0 || end < position)
+		{
+			return 0;
+		}
+		return uint64_t(end - position);
+	} // How much of the file is still to be read, so lengths stored in it can be checked against what is actually there.
+
+	void WriteFloats(std::ofstream& file, std::vector<float>& values)
+	{
+		uint64_t count = values.size();
+		file.write((const char*)&count, sizeof(count));
+		file.write((const char*)values.data(), count * sizeof(float));
+	} // Each buffer is its length followed by the raw floats.
+};
+
+#endif
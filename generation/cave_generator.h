@@ -3,8 +3,13 @@
 
 #include <iostream>
 #include <vector>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
 #include <time.h>
 
+#include "pipeline_profiler.h"
+
 // Script is used to generate the raw cave layout. This class does not concern itself with generating the mesh itself, it only deals with the cellular automata.
 
 class CaveGenerator
@@ -15,47 +20,105 @@ public:
 	int randomFillPercent;
 	int borderSize;
 	int seed;
-	std::vector<std::vector<int>> map;
-	std::vector<std::vector<int>> borderedMap;
+	bool tiledSmoothing; // Run every smoothing pass on one tile at a time rather than each pass over the whole map, the result is the same.
+	bool fusedFill; // Work out the random fill from a hash of each cell's position and smooth it as it is made, gives a different cave for the same seed.
+	std::vector<std::vector<int>> borderedMap; // The map with borderSize cells of wall around every side.
+	std::vector<std::vector<std::vector<int>>> mapPyramid; // Each coarser level of detail of the bordered map, which is itself the full resolution level.
+
+	// The cellular automata rule set, anything that changes the generated map for a given seed belongs here.
+	static const int smoothPasses = 5;
+	static const int wallThreshold = 4; // A tile with more wall neighbours than this becomes wall, with fewer it becomes floor.
+	static const int smoothTileSize = 64; // Cells along each side of a tile when smoothing is tiled.
 
-	CaveGenerator(int newWidth, int newHeight, int newRandomFillPercentage, int seed, int borderSize = 5)
+	CaveGenerator(int newWidth, int newHeight, int newRandomFillPercentage, int seed, int borderSize = 5, bool tiledSmoothing = false, bool fusedFill = false)
 	{
 		CaveGenerator::width = newWidth;
 		CaveGenerator::height = newHeight;
 		CaveGenerator::randomFillPercent = newRandomFillPercentage;
 		CaveGenerator::borderSize = borderSize;
 		CaveGenerator::seed = seed;
+		CaveGenerator::tiledSmoothing = tiledSmoothing;
+		CaveGenerator::fusedFill = fusedFill;
 		GenerateMap();
 	}
 
+	void BuildMapPyramid(int levelCount)
+	{
+		mapPyramid = std::vector<std::vector<std::vector<int>>>();
+
+		for (int level = 1; level < levelCount; level++)
+		{
+			const std::vector<std::vector<int>>& finerMap = GetMapLevel(level - 1);
+			int finerWidth = finerMap.size();
+			int finerHeight = finerWidth == 0 ? 0 : finerMap[0].size();
+			if (finerWidth < 3 || finerHeight < 3)
+			{
+				break;
+			}
+
+			std::vector<std::vector<int>> coarserMap = std::vector<std::vector<int>>(finerWidth / 2 + 1, std::vector<int>(finerHeight / 2 + 1, 0));
+			for (int x = 0; x < int(coarserMap.size()); x++)
+			{
+				for (int y = 0; y < int(coarserMap[x].size()); y++)
+				{
+					coarserMap[x][y] = GetMajorityCell(finerMap, x * 2, y * 2);
+				}
+			}
+			mapPyramid.push_back(std::move(coarserMap));
+		}
+	} // Builds levels of detail of the bordered map, each half the resolution of the one before. A coarser cell sits on every other finer cell, so the levels
+	  // line up and share the same chunk edges. When a finer side is even its last coarser cell sits one finer cell past the edge, its vote only covers the
+	  // finer edge cells, so it copies the wall border rather than being forced to wall by cells that do not exist.
+
+	int GetMapLevelCount()
+	{
+		return int(mapPyramid.size()) + 1;
+	}
+
+	const std::vector<std::vector<int>>& GetMapLevel(int level)
+	{
+		return level == 0 ? borderedMap : mapPyramid[level - 1];
+	} // Level 0 is the bordered map, so the full resolution grid is never copied into the pyramid.
+
 private:
+	std::vector<std::vector<int>> smoothMap; // The map each smoothing pass writes to, only held while the map is generated.
+
 	void GenerateMap()
 	{
-		map = std::vector<std::vector<int>>(width, std::vector<int>(height, 0));
-		RandomFillMap();
+		static const char* smoothPassNames[smoothPasses] = { "SmoothMap 1", "SmoothMap 2", "SmoothMap 3", "SmoothMap 4", "SmoothMap 5" };
 
-		for (int i = 0; i < 5; i++)
+		borderedMap = std::vector<std::vector<int>>(width + borderSize * 2, std::vector<int>(height + borderSize * 2, 1));
+		int firstPass = 0;
+		if (fusedFill)
 		{
-			SmoothMap();
+			ScopedTimer timer("RandomFillMap + SmoothMap 1");
+			RandomFillAndSmoothMap();
+			firstPass = 1;
+		}
+		else
+		{
+			ScopedTimer timer("RandomFillMap");
+			RandomFillMap();
 		}
 
-		borderedMap = std::vector<std::vector<int>>(width + borderSize * 2, std::vector<int>(height + borderSize * 2, 0));
-
-		for (int x = 0; x < borderedMap.size(); x++)
+		smoothMap = std::vector<std::vector<int>>(width + borderSize * 2, std::vector<int>(height + borderSize * 2, 1));
+		if (tiledSmoothing)
+		{
+			ScopedTimer timer("SmoothMap tiled");
+			SmoothMapTiled(smoothPasses - firstPass);
+		}
+		else
 		{
-			for (int y = 0; y < borderedMap[x].size(); y++)
+			for (int i = firstPass; i < smoothPasses; i++)
 			{
-				if (x >= borderSize && x < width + borderSize && y >= borderSize && y < height + borderSize) 
-				{
-					borderedMap[x][y] = map[x - borderSize][y - borderSize];
-				}
-				else 
-				{
-					borderedMap[x][y] = 1;
-				}
+				ScopedTimer timer(smoothPassNames[i]);
+				SmoothMap();
 			}
 		}
-	} // Creates and smooths the cave map. Then, creates a few layers of border around this map. 
+		smoothMap = std::vector<std::vector<int>>();
+		PipelineProfiler::Get().AddCount("Grid cells", borderedMap.empty() ? 0 : borderedMap.size() * borderedMap[0].size());
+	} // Creates and smooths the cave map. The map is generated straight into the middle of the bordered map, whose cells all start as wall, so the border is
+	  // there from the start and never has to be copied around the map.
 
 	void RandomFillMap()
 	{
@@ -74,45 +137,175 @@ private:
 			{
 				if (x == 0 || x == width - 1 || y == 0 || y == height - 1)
 				{
-					map[x][y] = 1;
+					borderedMap[x + borderSize][y + borderSize] = 1;
 				}
 				else
 				{
 					int chance = rand() % 100 + 1;
 					if (chance > randomFillPercent)
 					{
-						map[x][y] = 1;
+						borderedMap[x + borderSize][y + borderSize] = 1;
 					}
 					else
 					{
-						map[x][y] = 0;
+						borderedMap[x + borderSize][y + borderSize] = 0;
 					}
 				}
 			}
 		}
 	} // Randomly fills the map vector, the density of the cave can be adjusted by the randomFillPercentage parameter. 
 
-	void SmoothMap()
+	void RandomFillAndSmoothMap()
 	{
-		std::vector<std::vector<int>> smoothMap = std::vector<std::vector<int>>(width, std::vector<int>(height, 0));
+		if (seed == -1)
+		{
+			seed = time(NULL);
+		}
+
+		std::vector<int> previousColumn = std::vector<int>(height, 1);
+		std::vector<int> column = std::vector<int>(height, 1);
+		std::vector<int> nextColumn = std::vector<int>(height, 1);
+		FillColumn(0, nextColumn);
 		for (int x = 0; x < width; x++)
 		{
+			previousColumn.swap(column);
+			column.swap(nextColumn);
+			FillColumn(x + 1, nextColumn);
+
 			for (int y = 0; y < height; y++)
+			{
+				int neighbourWallTiles = previousColumn[y] + nextColumn[y];
+				neighbourWallTiles += y > 0 ? previousColumn[y - 1] + column[y - 1] + nextColumn[y - 1] : 3;
+				neighbourWallTiles += y < height - 1 ? previousColumn[y + 1] + column[y + 1] + nextColumn[y + 1] : 3;
+
+				if (neighbourWallTiles > wallThreshold)
+				{
+					borderedMap[x + borderSize][y + borderSize] = 1;
+				}
+				else
+				{
+					borderedMap[x + borderSize][y + borderSize] = 0;
+				}
+			}
+		}
+	} // Does the random fill and the first smoothing pass in one go. Each cell of the fill comes from its own position, so only the three columns the pass is
+	  // looking at are ever filled in, and the full random map is never written out or read back. Columns past either side of the map are all wall.
+
+	void FillColumn(int x, std::vector<int>& column)
+	{
+		for (int y = 0; y < height; y++)
+		{
+			if (x <= 0 || x >= width - 1 || y == 0 || y == height - 1)
+			{
+				column[y] = 1;
+			}
+			else
+			{
+				int chance = int(HashCell(x, y) % 100) + 1;
+				column[y] = chance > randomFillPercent ? 1 : 0;
+			}
+		}
+	} // Fills one column of the map the way RandomFillMap would, with the edges of the map always wall.
+
+	uint32_t HashCell(int x, int y)
+	{
+		uint32_t hash = uint32_t(seed) * 0x9E3779B1u ^ uint32_t(x) * 0x85EBCA77u ^ uint32_t(y) * 0xC2B2AE3Du;
+		hash ^= hash >> 16;
+		hash *= 0x7FEB352Du;
+		hash ^= hash >> 15;
+		hash *= 0x846CA68Bu;
+		hash ^= hash >> 16;
+		return hash;
+	} // Mixes the seed and a cell's position into a random number, the same cell of the same seed always gets the same one.
+
+	void SmoothMap()
+	{
+		for (int x = borderSize; x < width + borderSize; x++)
+		{
+			for (int y = borderSize; y < height + borderSize; y++)
 			{
 				int neighbourWallTiles = GetSurroundingWallCount(x, y);
 
-				if (neighbourWallTiles > 4)
+				if (neighbourWallTiles > wallThreshold)
 				{
 					smoothMap[x][y] = 1;
 				}
-				else if (neighbourWallTiles < 4)
+				else
 				{
 					smoothMap[x][y] = 0;
 				}
 			}
 		}
-		map = smoothMap;
-	} // Creates a new map where the the walls have been smoothened. If a empty square has more than 4 wall square adjacent to it then it will become a wall tile.
+		borderedMap.swap(smoothMap);
+	} // Creates a new map where the the walls have been smoothened. If a empty square has more than 4 wall square adjacent to it then it will become a wall tile,
+	  // a square with exactly 4 becomes empty. Only the middle of the spare map is written, its border stays wall, so the two maps can be swapped each pass.
+
+	void SmoothMapTiled(int passes)
+	{
+		int mapWidth = borderedMap.size();
+		int mapHeight = mapWidth == 0 ? 0 : borderedMap[0].size();
+		int halo = passes;
+		int tileSpan = smoothTileSize + halo * 2;
+		std::vector<int> tile = std::vector<int>(tileSpan * tileSpan, 1);
+		std::vector<int> smoothTile = std::vector<int>(tileSpan * tileSpan, 1);
+
+		for (int tileX = borderSize; tileX < width + borderSize; tileX += smoothTileSize)
+		{
+			for (int tileY = borderSize; tileY < height + borderSize; tileY += smoothTileSize)
+			{
+				int originX = tileX - halo;
+				int originY = tileY - halo;
+				for (int x = 0; x < tileSpan; x++)
+				{
+					for (int y = 0; y < tileSpan; y++)
+					{
+						int mapX = originX + x;
+						int mapY = originY + y;
+						int cell = mapX >= 0 && mapX < mapWidth && mapY >= 0 && mapY < mapHeight ? borderedMap[mapX][mapY] : 1;
+						tile[x * tileSpan + y] = cell;
+						smoothTile[x * tileSpan + y] = cell;
+					}
+				}
+
+				for (int pass = 1; pass <= passes; pass++)
+				{
+					for (int x = pass; x < tileSpan - pass; x++)
+					{
+						int mapX = originX + x;
+						if (mapX < borderSize || mapX >= width + borderSize)
+						{
+							continue;
+						}
+						for (int y = pass; y < tileSpan - pass; y++)
+						{
+							int mapY = originY + y;
+							if (mapY < borderSize || mapY >= height + borderSize)
+							{
+								continue;
+							}
+							const int* left = &tile[(x - 1) * tileSpan + y];
+							const int* middle = &tile[x * tileSpan + y];
+							const int* right = &tile[(x + 1) * tileSpan + y];
+							int neighbourWallTiles = left[-1] + left[0] + left[1] + middle[-1] + middle[1] + right[-1] + right[0] + right[1];
+							smoothTile[x * tileSpan + y] = neighbourWallTiles > wallThreshold ? 1 : 0;
+						}
+					}
+					tile.swap(smoothTile);
+				}
+
+				for (int x = halo; x < halo + smoothTileSize && originX + x < width + borderSize; x++)
+				{
+					for (int y = halo; y < halo + smoothTileSize && originY + y < height + borderSize; y++)
+					{
+						smoothMap[originX + x][originY + y] = tile[x * tileSpan + y];
+					}
+				}
+			}
+		}
+		borderedMap.swap(smoothMap);
+	} // Runs all the smoothing passes on one tile of the map while it is in cache, instead of sweeping the whole map through memory once per pass. Each tile is
+	  // copied out with a halo of one cell per pass around it. Every pass leaves one less ring of the halo correct, so after the last pass exactly the tile itself
+	  // is, and it matches SmoothMap run the same number of times. Cells outside the map count as wall, as they do in GetSurroundingWallCount.
 
 	int GetSurroundingWallCount(int gridX, int gridY)
 	{
@@ -121,11 +314,11 @@ private:
 		{
 			for (int neighbourY = gridY - 1; neighbourY <= gridY + 1; neighbourY++)
 			{
-				if (neighbourX >= 0 && neighbourX < width && neighbourY >= 0 && neighbourY < height)
+				if (neighbourX >= 0 && neighbourX < int(borderedMap.size()) && neighbourY >= 0 && neighbourY < int(borderedMap[neighbourX].size()))
 				{
 					if (neighbourX != gridX || neighbourY != gridY)
 					{
-						wallCount += map[neighbourX][neighbourY];
+						wallCount += borderedMap[neighbourX][neighbourY];
 					}
 				}
 				else
@@ -136,7 +329,24 @@ private:
 		}
 
 		return wallCount;
-	} // Returns the amount of wall squares directly adjacent to the inputted square.
+	} // Returns the amount of wall squares directly adjacent to the inputted square. Border squares are wall, anything past the border counts as wall too.
+
+	int GetMajorityCell(const std::vector<std::vector<int>>& finerMap, int gridX, int gridY)
+	{
+		int wallCount = 0;
+		int cellCount = 0;
+		for (int neighbourX = std::max(gridX - 1, 0); neighbourX <= std::min(gridX + 1, int(finerMap.size()) - 1); neighbourX++)
+		{
+			for (int neighbourY = std::max(gridY - 1, 0); neighbourY <= std::min(gridY + 1, int(finerMap[neighbourX].size()) - 1); neighbourY++)
+			{
+				wallCount += finerMap[neighbourX][neighbourY];
+				cellCount++;
+			}
+		}
+
+		return wallCount * 2 >= cellCount ? 1 : 0;
+	} // Majority vote over the 3 by 3 block of finer cells centered on a coarser cell, clamped to the finer map. Only cells that exist get a vote and a tie
+	  // goes to wall, a block with nothing left in it is wall.
 
 };
 
@@ -0,0 +1,344 @@
+#ifndef CAVE_MESH_FILE_CLASS
+#define CAVE_MESH_FILE_CLASS
+
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <fstream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "mesh_chunk.h"
+
+// Binary file for caves that are generated ahead of time. The file is laid out exactly as the renderer wants it, so it is memory mapped and the vertex blobs are
+// handed straight to glBufferData without being parsed or copied. Everything is stored little endian.
+//
+//   CaveMeshHeader
+//   chunk table, one CaveMeshChunkRecord per chunk
+//   floor vertices, position and colour
+//   wall vertices, position and texture coordinates
+//
+// The chunk table and each blob start on a multiple of blobAlignment. Floor vertices are always 6 floats and wall vertices 5, the layouts FlatCave draws, so a
+// file with any other stride is refused rather than uploaded. There is no index blob, the renderer draws every triangle from its own three vertices.
+
+struct CaveMeshHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t floorVertexFloats;
+	uint32_t wallVertexFloats;
+	uint32_t chunkCount;
+	uint32_t reserved;
+	uint64_t chunkTableOffset;
+	uint64_t floorOffset;
+	uint64_t floorBytes;
+	uint64_t wallOffset;
+	uint64_t wallBytes;
+	uint64_t fileBytes;
+};
+
+struct CaveMeshChunkRecord
+{
+	uint32_t firstTriangle;
+	uint32_t triangleCount;
+	uint32_t firstWallTriangle;
+	uint32_t wallTriangleCount;
+	float boundsMin[3];
+	float boundsMax[3];
+};
+
+class CaveMeshFile
+{
+public:
+	static const uint32_t version = 1;
+	static const uint32_t floorVertexFloats = 6; // Position and colour.
+	static const uint32_t wallVertexFloats = 5; // Position and texture coordinates.
+	static const uint64_t blobAlignment = 64;
+
+	const unsigned char* data;
+	size_t size;
+	const CaveMeshHeader* header;
+
+	CaveMeshFile()
+	{
+		CaveMeshFile::data = nullptr;
+		CaveMeshFile::size = 0;
+		CaveMeshFile::header = nullptr;
+#ifdef _WIN32
+		CaveMeshFile::fileHandle = INVALID_HANDLE_VALUE;
+		CaveMeshFile::mappingHandle = NULL;
+#endif
+	}
+
+	CaveMeshFile(const CaveMeshFile&) = delete;
+	CaveMeshFile& operator=(const CaveMeshFile&) = delete;
+
+	~CaveMeshFile()
+	{
+		Close();
+	}
+
+	static bool Write(const std::string& path, std::vector<float>& verticesFloor, std::vector<float>& verticesWalls, std::vector<MeshChunk>& chunks)
+	{
+		std::vector<CaveMeshChunkRecord> records = std::vector<CaveMeshChunkRecord>();
+		for (unsigned int i = 0; i < chunks.size(); i++)
+		{
+			CaveMeshChunkRecord record;
+			record.firstTriangle = chunks[i].firstTriangle;
+			record.triangleCount = chunks[i].triangleCount;
+			record.firstWallTriangle = chunks[i].firstWallTriangle;
+			record.wallTriangleCount = chunks[i].wallTriangleCount;
+			for (int j = 0; j < 3; j++)
+			{
+				record.boundsMin[j] = chunks[i].boundsMin[j];
+				record.boundsMax[j] = chunks[i].boundsMax[j];
+			}
+			records.push_back(record);
+		}
+		if (records.empty())
+		{
+			CaveMeshChunkRecord record;
+			memset(&record, 0, sizeof(record));
+			record.triangleCount = verticesFloor.size() / (floorVertexFloats * 3);
+			record.wallTriangleCount = verticesWalls.size() / (wallVertexFloats * 3);
+			records.push_back(record);
+		}
+
+		CaveMeshHeader header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, "CAVM", 4);
+		header.version = version;
+		header.floorVertexFloats = floorVertexFloats;
+		header.wallVertexFloats = wallVertexFloats;
+		header.chunkCount = records.size();
+		header.chunkTableOffset = Align(sizeof(CaveMeshHeader));
+		header.floorOffset = Align(header.chunkTableOffset + records.size() * sizeof(CaveMeshChunkRecord));
+		header.floorBytes = verticesFloor.size() * sizeof(float);
+		header.wallOffset = Align(header.floorOffset + header.floorBytes);
+		header.wallBytes = verticesWalls.size() * sizeof(float);
+		header.fileBytes = header.wallOffset + header.wallBytes;
+
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			return false;
+		}
+		file.write((const char*)&header, sizeof(header));
+		WritePadding(file, sizeof(header), header.chunkTableOffset);
+		file.write((const char*)records.data(), records.size() * sizeof(CaveMeshChunkRecord));
+		WritePadding(file, header.chunkTableOffset + records.size() * sizeof(CaveMeshChunkRecord), header.floorOffset);
+		file.write((const char*)verticesFloor.data(), header.floorBytes);
+		WritePadding(file, header.floorOffset + header.floorBytes, header.wallOffset);
+		file.write((const char*)verticesWalls.data(), header.wallBytes);
+		return bool(file);
+	} // Writes the final vertex buffers and chunks of a cave. A cave that was not split into chunks can pass no chunks, one covering everything with empty bounds is written instead.
+
+	bool Open(const std::string& path)
+	{
+		Close();
+		if (!Map(path))
+		{
+			return false;
+		}
+
+		header = (const CaveMeshHeader*)data;
+		if (size < sizeof(CaveMeshHeader) || memcmp(header->magic, "CAVM", 4) != 0 || header->version != version || header->fileBytes > size
+			|| header->floorVertexFloats != floorVertexFloats || header->wallVertexFloats != wallVertexFloats
+			|| !InRange(header->chunkTableOffset, uint64_t(header->chunkCount) * sizeof(CaveMeshChunkRecord))
+			|| !InRange(header->floorOffset, header->floorBytes) || !InRange(header->wallOffset, header->wallBytes)
+			|| header->floorBytes % (header->floorVertexFloats * 3 * sizeof(float)) != 0 || header->wallBytes % (header->wallVertexFloats * 3 * sizeof(float)) != 0
+			|| !ChunksInRange())
+		{
+			Close();
+			return false;
+		}
+		return true;
+	} // Maps the file and checks the header and the chunk table, nothing else is read until it is used.
+
+	void Close()
+	{
+#ifdef _WIN32
+		if (data != nullptr)
+		{
+			UnmapViewOfFile(data);
+		}
+		if (mappingHandle != NULL)
+		{
+			CloseHandle(mappingHandle);
+		}
+		if (fileHandle != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(fileHandle);
+		}
+		fileHandle = INVALID_HANDLE_VALUE;
+		mappingHandle = NULL;
+#else
+		if (data != nullptr)
+		{
+			munmap((void*)data, size);
+		}
+#endif
+		data = nullptr;
+		size = 0;
+		header = nullptr;
+	}
+
+	const float* GetFloorVertices()
+	{
+		return (const float*)(data + header->floorOffset);
+	}
+
+	size_t GetFloorFloatCount()
+	{
+		return header->floorBytes / sizeof(float);
+	}
+
+	const float* GetWallVertices()
+	{
+		return (const float*)(data + header->wallOffset);
+	}
+
+	size_t GetWallFloatCount()
+	{
+		return header->wallBytes / sizeof(float);
+	}
+
+	const CaveMeshChunkRecord* GetChunks()
+	{
+		return (const CaveMeshChunkRecord*)(data + header->chunkTableOffset);
+	}
+
+	std::vector<MeshChunk> ReadChunks()
+	{
+		std::vector<MeshChunk> chunks = std::vector<MeshChunk>();
+		const CaveMeshChunkRecord* records = GetChunks();
+		for (unsigned int i = 0; i < header->chunkCount; i++)
+		{
+			MeshChunk chunk = MeshChunk();
+			chunk.firstTriangle = records[i].firstTriangle;
+			chunk.triangleCount = records[i].triangleCount;
+			chunk.firstWallTriangle = records[i].firstWallTriangle;
+			chunk.wallTriangleCount = records[i].wallTriangleCount;
+			chunk.boundsMin = glm::vec3(records[i].boundsMin[0], records[i].boundsMin[1], records[i].boundsMin[2]);
+			chunk.boundsMax = glm::vec3(records[i].boundsMax[0], records[i].boundsMax[1], records[i].boundsMax[2]);
+			chunks.push_back(chunk);
+		}
+		return chunks;
+	} // Copies the chunk table out into MeshChunks, it is small enough that this costs nothing next to the vertices.
+
+	const float* GetChunkFloorVertices(unsigned int chunkIndex)
+	{
+		return GetFloorVertices() + size_t(GetChunks()[chunkIndex].firstTriangle) * 3 * header->floorVertexFloats;
+	}
+
+	const float* GetChunkWallVertices(unsigned int chunkIndex)
+	{
+		return GetWallVertices() + size_t(GetChunks()[chunkIndex].firstWallTriangle) * 3 * header->wallVertexFloats;
+	} // A chunk's vertices are contiguous, so a single chunk can be uploaded on its own and only its pages are read from disk.
+
+private:
+#ifdef _WIN32
+	HANDLE fileHandle;
+	HANDLE mappingHandle;
+#endif
+
+	bool Map(const std::string& path)
+	{
+#ifdef _WIN32
+		fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (fileHandle == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0)
+		{
+			Close();
+			return false;
+		}
+		mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mappingHandle == NULL)
+		{
+			Close();
+			return false;
+		}
+		data = (const unsigned char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+		size = size_t(fileSize.QuadPart);
+#else
+		int fileDescriptor = open(path.c_str(), O_RDONLY);
+		if (fileDescriptor < 0)
+		{
+			return false;
+		}
+		struct stat fileStatus;
+		if (fstat(fileDescriptor, &fileStatus) != 0 || fileStatus.st_size == 0)
+		{
+			close(fileDescriptor);
+			return false;
+		}
+		void* mapping = mmap(nullptr, size_t(fileStatus.st_size), PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+		close(fileDescriptor);
+		if (mapping == MAP_FAILED)
+		{
+			return false;
+		}
+		data = (const unsigned char*)mapping;
+		size = size_t(fileStatus.st_size);
+#endif
+		if (data == nullptr)
+		{
+			Close();
+			return false;
+		}
+		return true;
+	} // Maps the whole file read only, the operating system pages it in as it is touched.
+
+	bool InRange(uint64_t offset, uint64_t bytes)
+	{
+		return offset % blobAlignment == 0 && offset <= size && bytes <= size - offset;
+	}
+
+	bool ChunksInRange()
+	{
+		uint64_t floorTriangles = header->floorBytes / (header->floorVertexFloats * 3 * sizeof(float));
+		uint64_t wallTriangles = header->wallBytes / (header->wallVertexFloats * 3 * sizeof(float));
+		const CaveMeshChunkRecord* records = GetChunks();
+		for (unsigned int i = 0; i < header->chunkCount; i++)
+		{
+			if (uint64_t(records[i].firstTriangle) + records[i].triangleCount > floorTriangles
+				|| uint64_t(records[i].firstWallTriangle) + records[i].wallTriangleCount > wallTriangles)
+			{
+				return false;
+			}
+		}
+		return true;
+	} // Every chunk must lie inside the floor and wall blobs, otherwise reading a chunk's vertices would run off the end of the mapping.
+
+	static uint64_t Align(uint64_t offset)
+	{
+		return (offset + blobAlignment - 1) / blobAlignment * blobAlignment;
+	}
+
+	static void WritePadding(std::ofstream& file, uint64_t from, uint64_t to)
+	{
+		static const char zeros[blobAlignment] = {};
+		file.write(zeros, to - from);
+	}
+};
+
+#endif
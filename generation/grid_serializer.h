@@ -0,0 +1,292 @@
+#ifndef GRID_SERIALIZER_CLASS
+#define GRID_SERIALIZER_CLASS
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Stores a cave grid in a few hundred bytes. Each row of the grid is packed to one bit per tile, and the lengths of its alternating runs of floor and wall are
+// written as variable length integers. A smoothed cave has long runs, so most rows take only a handful of bytes. Border rows and columns are always wall, so
+// only their width is stored.
+//
+//   'C' 'G' version
+//   width, height, border size        inner grid size, as variable length integers
+//   for each row: run lengths          starting with a run of floor, which may be 0, until the row is filled
+//
+// Rows are the outer vector of the grid, map[x].
+
+class GridSerializer
+{
+public:
+	static const uint8_t version = 1;
+	static const uint64_t maxGridCells = uint64_t(1) << 26; // Tiles in a decoded grid border included, 8192 by 8192 and far past any cave the generator makes.
+
+	static std::vector<uint8_t> Encode(const std::vector<std::vector<int>>& grid, int borderSize = 0)
+	{
+		int gridWidth = grid.size();
+		int gridHeight = gridWidth == 0 ? 0 : grid[0].size();
+		if (!HasWallBorder(grid, borderSize))
+		{
+			borderSize = 0;
+		}
+		int width = gridWidth - borderSize * 2;
+		int height = gridHeight - borderSize * 2;
+
+		std::vector<uint8_t> data = std::vector<uint8_t>();
+		data.push_back('C');
+		data.push_back('G');
+		data.push_back(uint8_t(version));
+		WriteVarint(data, width);
+		WriteVarint(data, height);
+		WriteVarint(data, borderSize);
+
+		int wordCount = (height + 63) / 64;
+		std::vector<uint64_t> packedRow = std::vector<uint64_t>(wordCount, 0);
+		for (int x = 0; x < width; x++)
+		{
+			const std::vector<int>& row = grid[x + borderSize];
+			for (int word = 0; word < wordCount; word++)
+			{
+				uint64_t bits = 0;
+				int count = std::min(64, height - word * 64);
+				for (int bit = 0; bit < count; bit++)
+				{
+					bits |= uint64_t(row[borderSize + word * 64 + bit] != 0) << bit;
+				}
+				packedRow[word] = bits;
+			}
+
+			int position = 0;
+			bool runBit = false;
+			while (position < height)
+			{
+				int end = FindNextBit(packedRow, position, !runBit, height);
+				WriteVarint(data, end - position);
+				position = end;
+				runBit = !runBit;
+			}
+		}
+
+		return data;
+	} // Encodes the grid, leaving out borderSize rows and columns on each side when they are all wall.
+
+	static bool Decode(const uint8_t* data, size_t size, std::vector<std::vector<int>>& grid, int expectedWidth = -1, int expectedHeight = -1)
+	{
+		size_t offset = 3;
+		uint64_t width = 0;
+		uint64_t height = 0;
+		uint64_t borderSize = 0;
+		if (size < 3 || data[0] != 'C' || data[1] != 'G' || data[2] != version || !ReadVarint(data, size, offset, width) || !ReadVarint(data, size, offset, height)
+			|| !ReadVarint(data, size, offset, borderSize) || width > (1 << 20) || height > (1 << 20) || borderSize > (1 << 16)
+			|| (height > 0 && width > (size - offset) / VarintLength(height)) || (width + borderSize * 2) * (height + borderSize * 2) > maxGridCells
+			|| (expectedWidth >= 0 && width + borderSize * 2 != uint64_t(expectedWidth)) || (expectedHeight >= 0 && height + borderSize * 2 != uint64_t(expectedHeight))
+			|| !CheckRuns(data, size, offset, width, height))
+		{
+			return false;
+		}
+
+		int gridWidth = int(width + borderSize * 2);
+		int gridHeight = int(height + borderSize * 2);
+		grid = std::vector<std::vector<int>>(gridWidth, std::vector<int>(gridHeight, 1));
+
+		int wordCount = int(height + 63) / 64;
+		std::vector<uint64_t> packedRow = std::vector<uint64_t>(wordCount, 0);
+		for (uint64_t x = 0; x < width; x++)
+		{
+			std::fill(packedRow.begin(), packedRow.end(), 0);
+			uint64_t position = 0;
+			bool runBit = false;
+			while (position < height)
+			{
+				uint64_t run = 0;
+				if (!ReadVarint(data, size, offset, run) || run > height - position)
+				{
+					return false;
+				}
+				if (runBit)
+				{
+					SetBits(packedRow, position, position + run);
+				}
+				position += run;
+				runBit = !runBit;
+			}
+
+			ExpandBits(packedRow, height, grid[x + borderSize].data() + borderSize);
+		}
+		return offset == size;
+	} // Rebuilds the grid with its border, returns false if the data is not a complete encoded grid. Nothing is allocated until the header has been checked and
+	  // the runs have been walked once to make sure they fill exactly width rows of height tiles. A row takes at least as many bytes as the height does written
+	  // as a variable length integer, and no grid is bigger than maxGridCells, so a short corrupt header cannot ask for a huge grid. A caller that knows the grid
+	  // size it wants passes it as well.
+
+	static bool Decode(const std::vector<uint8_t>& data, std::vector<std::vector<int>>& grid, int expectedWidth = -1, int expectedHeight = -1)
+	{
+		return Decode(data.data(), data.size(), grid, expectedWidth, expectedHeight);
+	}
+
+private:
+	struct ExpansionTable
+	{
+		int tiles[256][8];
+
+		ExpansionTable()
+		{
+			for (int value = 0; value < 256; value++)
+			{
+				for (int bit = 0; bit < 8; bit++)
+				{
+					tiles[value][bit] = (value >> bit) & 1;
+				}
+			}
+		}
+	}; // The eight tiles every possible byte of packed bits expands to.
+
+	static bool HasWallBorder(const std::vector<std::vector<int>>& grid, int borderSize)
+	{
+		int gridWidth = grid.size();
+		int gridHeight = gridWidth == 0 ? 0 : grid[0].size();
+		if (borderSize <= 0 || borderSize * 2 > gridWidth || borderSize * 2 > gridHeight)
+		{
+			return false;
+		}
+		for (int x = 0; x < gridWidth; x++)
+		{
+			for (int y = 0; y < gridHeight; y++)
+			{
+				bool inBorder = x < borderSize || x >= gridWidth - borderSize || y < borderSize || y >= gridHeight - borderSize;
+				if (inBorder && grid[x][y] == 0)
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	static int FindNextBit(const std::vector<uint64_t>& words, int position, bool value, int bitCount)
+	{
+		int word = position >> 6;
+		uint64_t bits = (value ? words[word] : ~words[word]) & (~uint64_t(0) << (position & 63));
+		while (bits == 0)
+		{
+			word++;
+			if (word >= int(words.size()))
+			{
+				return bitCount;
+			}
+			bits = value ? words[word] : ~words[word];
+		}
+		return std::min(word * 64 + CountTrailingZeros(bits), bitCount);
+	} // Position of the first bit at or after position that equals value, or bitCount if there is none. Whole words are skipped at a time.
+
+	static void SetBits(std::vector<uint64_t>& words, uint64_t start, uint64_t end)
+	{
+		while (start < end)
+		{
+			uint64_t word = start >> 6;
+			uint64_t first = start & 63;
+			uint64_t count = std::min<uint64_t>(64 - first, end - start);
+			words[word] |= (count == 64 ? ~uint64_t(0) : ((uint64_t(1) << count) - 1)) << first;
+			start += count;
+		}
+	} // Sets every bit in [start, end), a word at a time.
+
+	static void ExpandBits(const std::vector<uint64_t>& words, uint64_t bitCount, int* tiles)
+	{
+		static const ExpansionTable table;
+
+		uint64_t bit = 0;
+		for (; bit + 8 <= bitCount; bit += 8)
+		{
+			memcpy(tiles + bit, table.tiles[(words[bit >> 6] >> (bit & 63)) & 0xFF], sizeof(table.tiles[0]));
+		}
+		for (; bit < bitCount; bit++)
+		{
+			tiles[bit] = (words[bit >> 6] >> (bit & 63)) & 1;
+		}
+	} // Turns packed bits back into one int per tile eight at a time through a lookup table, each step is a single 32 byte copy the compiler can vectorise.
+
+	static int CountTrailingZeros(uint64_t value)
+	{
+#if defined(_MSC_VER) && defined(_M_X64)
+		unsigned long index;
+		_BitScanForward64(&index, value);
+		return int(index);
+#elif defined(_MSC_VER)
+		unsigned long index;
+		if (_BitScanForward(&index, (unsigned long)value))
+		{
+			return int(index);
+		}
+		_BitScanForward(&index, (unsigned long)(value >> 32));
+		return int(index) + 32;
+#else
+		return __builtin_ctzll(value);
+#endif
+	} // Value must not be 0.
+
+	static bool CheckRuns(const uint8_t* data, size_t size, size_t offset, uint64_t width, uint64_t height)
+	{
+		for (uint64_t x = 0; x < width; x++)
+		{
+			uint64_t position = 0;
+			while (position < height)
+			{
+				uint64_t run = 0;
+				if (!ReadVarint(data, size, offset, run) || run > height - position)
+				{
+					return false;
+				}
+				position += run;
+			}
+		}
+		return offset == size;
+	} // True if the runs from offset on fill width rows of height tiles and end with the data, without writing anything.
+
+	static size_t VarintLength(uint64_t value)
+	{
+		size_t length = 1;
+		while (value >= 0x80)
+		{
+			value >>= 7;
+			length++;
+		}
+		return length;
+	}
+
+	static void WriteVarint(std::vector<uint8_t>& data, uint64_t value)
+	{
+		while (value >= 0x80)
+		{
+			data.push_back(uint8_t(value | 0x80));
+			value >>= 7;
+		}
+		data.push_back(uint8_t(value));
+	} // Seven bits per byte, lowest first, the top bit set on every byte but the last.
+
+	static bool ReadVarint(const uint8_t* data, size_t size, size_t& offset, uint64_t& value)
+	{
+		value = 0;
+		for (int shift = 0; shift < 64; shift += 7)
+		{
+			if (offset >= size)
+			{
+				return false;
+			}
+			uint8_t byte = data[offset++];
+			value |= uint64_t(byte & 0x7F) << shift;
+			if ((byte & 0x80) == 0)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+};
+
+#endif
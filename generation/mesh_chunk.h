@@ -0,0 +1,26 @@
+#ifndef MESH_CHUNK_STRUCT
+#define MESH_CHUNK_STRUCT
+
+#include <glm/glm.hpp>
+
+struct MeshChunk
+{
+	int firstTriangle;
+	int triangleCount;
+	int firstWallTriangle;
+	int wallTriangleCount;
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+
+	MeshChunk()
+	{
+		MeshChunk::firstTriangle = 0;
+		MeshChunk::triangleCount = 0;
+		MeshChunk::firstWallTriangle = 0;
+		MeshChunk::wallTriangleCount = 0;
+		MeshChunk::boundsMin = glm::vec3(0.0f, 0.0f, 0.0f);
+		MeshChunk::boundsMax = glm::vec3(0.0f, 0.0f, 0.0f);
+	}
+}; // A square block of the grid. Its floor and wall triangles are stored next to each other so the chunk can be drawn as one range of each buffer.
+
+#endif
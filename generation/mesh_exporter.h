@@ -0,0 +1,300 @@
+#ifndef MESH_EXPORTER_CLASS
+#define MESH_EXPORTER_CLASS
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdarg>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "mesh_generator.h"
+#include "buffered_writer.h"
+#include "pipeline_profiler.h"
+
+// Exports a generated cave for other tools. The ceiling, floor and walls are written exactly as they are drawn: the ceiling is the floor mesh where it was
+// generated, the floor is the same mesh moved down by the wall height. Everything is read straight out of the MeshGenerator a chunk at a time and streamed
+// through a BufferedWriter, so exporting never holds a second copy of the mesh.
+
+class MeshExporter
+{
+public:
+	MeshGenerator& mesh;
+	size_t bytesWritten;
+
+	MeshExporter(MeshGenerator& mesh) : mesh(mesh)
+	{
+		MeshExporter::bytesWritten = 0;
+	}
+
+	bool WriteObj(const std::string& path)
+	{
+		ScopedTimer timer("Export OBJ");
+		BufferedWriter writer;
+		if (!writer.Open(path))
+		{
+			return false;
+		}
+
+		writer.WriteText("# Cave exported by CaveGenerationSystem\no cave\n");
+		WriteObjVertices(writer, mesh.vertices, 0.0f);
+		WriteObjVertices(writer, mesh.vertices, -mesh.wallHeight);
+		WriteObjVertices(writer, mesh.wallVertices, 0.0f);
+
+		size_t floorVertexStart = mesh.vertices.size();
+		size_t wallVertexStart = mesh.vertices.size() * 2;
+		for (unsigned int i = 0; i < mesh.chunks.size(); i++)
+		{
+			WriteObjFaces(writer, "ceiling", i, mesh.triangles, mesh.chunks[i].firstTriangle, mesh.chunks[i].triangleCount, 0);
+		}
+		for (unsigned int i = 0; i < mesh.chunks.size(); i++)
+		{
+			WriteObjFaces(writer, "floor", i, mesh.triangles, mesh.chunks[i].firstTriangle, mesh.chunks[i].triangleCount, floorVertexStart);
+		}
+		for (unsigned int i = 0; i < mesh.chunks.size(); i++)
+		{
+			WriteObjFaces(writer, "walls", i, mesh.wallTriangles, mesh.chunks[i].firstWallTriangle, mesh.chunks[i].wallTriangleCount, wallVertexStart);
+		}
+
+		bytesWritten = writer.bytesWritten;
+		return writer.Close();
+	} // Wavefront OBJ with a group for each part of each chunk, such as 'walls_3'.
+
+	bool WritePly(const std::string& path)
+	{
+		ScopedTimer timer("Export PLY");
+		BufferedWriter writer;
+		if (!writer.Open(path))
+		{
+			return false;
+		}
+
+		size_t vertexCount = mesh.vertices.size() * 2 + mesh.wallVertices.size();
+		size_t faceCount = (mesh.triangles.size() * 2 + mesh.wallTriangles.size()) / 3;
+		writer.WriteText("ply\nformat binary_little_endian 1.0\ncomment Cave exported by CaveGenerationSystem\n");
+		writer.WriteFormat("element vertex %zu\nproperty float x\nproperty float y\nproperty float z\n", vertexCount);
+		writer.WriteFormat("element face %zu\nproperty list uchar uint vertex_indices\nend_header\n", faceCount);
+
+		WritePositions(writer, mesh.vertices, 0.0f);
+		WritePositions(writer, mesh.vertices, -mesh.wallHeight);
+		WritePositions(writer, mesh.wallVertices, 0.0f);
+
+		size_t floorVertexStart = mesh.vertices.size();
+		size_t wallVertexStart = mesh.vertices.size() * 2;
+		for (unsigned int i = 0; i < mesh.chunks.size(); i++)
+		{
+			WritePlyFaces(writer, mesh.triangles, mesh.chunks[i].firstTriangle, mesh.chunks[i].triangleCount, 0);
+		}
+		for (unsigned int i = 0; i < mesh.chunks.size(); i++)
+		{
+			WritePlyFaces(writer, mesh.triangles, mesh.chunks[i].firstTriangle, mesh.chunks[i].triangleCount, floorVertexStart);
+		}
+		for (unsigned int i = 0; i < mesh.chunks.size(); i++)
+		{
+			WritePlyFaces(writer, mesh.wallTriangles, mesh.chunks[i].firstWallTriangle, mesh.chunks[i].wallTriangleCount, wallVertexStart);
+		}
+
+		bytesWritten = writer.bytesWritten;
+		return writer.Close();
+	} // Binary little endian PLY. The format has no groups, so the faces of every part are written one after another.
+
+	bool WriteGlb(const std::string& path)
+	{
+		ScopedTimer timer("Export GLB");
+
+		size_t floorPositionBytes = mesh.vertices.size() * sizeof(float) * 3;
+		size_t floorIndexBytes = mesh.triangles.size() * sizeof(uint32_t);
+		size_t wallPositionBytes = mesh.wallVertices.size() * sizeof(float) * 3;
+		size_t wallIndexBytes = mesh.wallTriangles.size() * sizeof(uint32_t);
+		size_t binaryBytes = floorPositionBytes + floorIndexBytes + wallPositionBytes + wallIndexBytes;
+
+		std::string json = "{\"asset\":{\"version\":\"2.0\",\"generator\":\"CaveGenerationSystem\"},\"scene\":0";
+		std::string nodes = "";
+		std::string meshes = "";
+		std::string bufferViews = "";
+		std::string accessors = "";
+		int accessorCount = 0;
+		int meshCount = 0;
+
+		if (!mesh.triangles.empty())
+		{
+			AddGlbMesh("cave", mesh.vertices, floorPositionBytes, 0, false, meshes, bufferViews, accessors, accessorCount);
+			AddJson(nodes, FormatText("{\"name\":\"ceiling\",\"mesh\":%d}", meshCount));
+			AddJson(nodes, FormatText("{\"name\":\"floor\",\"mesh\":%d,\"translation\":[0,%.9g,0]}", meshCount, -mesh.wallHeight));
+			meshCount++;
+		}
+		if (!mesh.wallTriangles.empty())
+		{
+			AddGlbMesh("walls", mesh.wallVertices, wallPositionBytes, floorPositionBytes + floorIndexBytes, true, meshes, bufferViews, accessors, accessorCount);
+			AddJson(nodes, FormatText("{\"name\":\"walls\",\"mesh\":%d}", meshCount));
+			meshCount++;
+		}
+
+		std::string sceneNodes = "";
+		for (int i = 0; i < (mesh.triangles.empty() ? 0 : 2) + (mesh.wallTriangles.empty() ? 0 : 1); i++)
+		{
+			AddJson(sceneNodes, FormatText("%d", i));
+		}
+		json += ",\"scenes\":[{\"nodes\":[" + sceneNodes + "]}]";
+		if (meshCount > 0)
+		{
+			json += ",\"nodes\":[" + nodes + "],\"meshes\":[" + meshes + "],\"accessors\":[" + accessors + "],\"bufferViews\":[" + bufferViews + "]";
+			json += FormatText(",\"buffers\":[{\"byteLength\":%zu}]", binaryBytes);
+		}
+		json += "}";
+		while (json.size() % 4 != 0)
+		{
+			json += " ";
+		}
+
+		BufferedWriter writer;
+		if (!writer.Open(path))
+		{
+			return false;
+		}
+		uint32_t binaryChunkBytes = meshCount > 0 ? uint32_t(8 + binaryBytes) : 0;
+		writer.WriteText("glTF");
+		writer.WriteValue<uint32_t>(2);
+		writer.WriteValue<uint32_t>(uint32_t(12 + 8 + json.size() + binaryChunkBytes));
+		writer.WriteValue<uint32_t>(uint32_t(json.size()));
+		writer.WriteText("JSON");
+		writer.Write(json.data(), json.size());
+
+		if (meshCount > 0)
+		{
+			writer.WriteValue<uint32_t>(uint32_t(binaryBytes));
+			writer.Write("BIN\0", 4);
+			WritePositions(writer, mesh.vertices, 0.0f);
+			for (unsigned int i = 0; i < mesh.chunks.size(); i++)
+			{
+				WriteIndices(writer, mesh.triangles, mesh.chunks[i].firstTriangle, mesh.chunks[i].triangleCount);
+			}
+			WritePositions(writer, mesh.wallVertices, 0.0f);
+			for (unsigned int i = 0; i < mesh.chunks.size(); i++)
+			{
+				WriteIndices(writer, mesh.wallTriangles, mesh.chunks[i].firstWallTriangle, mesh.chunks[i].wallTriangleCount);
+			}
+		}
+
+		bytesWritten = writer.bytesWritten;
+		return writer.Close();
+	} // Binary glTF. The floor is a second node using the ceiling's mesh moved down, so its geometry is only stored once. Every chunk is its own primitive, so an
+	  // editor can still tell them apart.
+
+private:
+	void WriteObjVertices(BufferedWriter& writer, std::vector<glm::vec3>& positions, float offsetY)
+	{
+		for (unsigned int i = 0; i < positions.size(); i++)
+		{
+			writer.WriteText("v ");
+			writer.WriteDecimal(positions[i].x);
+			writer.WriteText(" ");
+			writer.WriteDecimal(positions[i].y + offsetY);
+			writer.WriteText(" ");
+			writer.WriteDecimal(positions[i].z);
+			writer.WriteText("\n");
+		}
+	} // Positions are written to four decimal places, far finer than any square size the generator is used with.
+
+	void WriteObjFaces(BufferedWriter& writer, const char* part, unsigned int chunkIndex, std::vector<int>& indices, int firstTriangle, int triangleCount, size_t vertexStart)
+	{
+		if (triangleCount == 0)
+		{
+			return;
+		}
+		writer.WriteFormat("g %s_%u\n", part, chunkIndex);
+		for (int i = firstTriangle * 3; i < (firstTriangle + triangleCount) * 3; i += 3)
+		{
+			writer.WriteText("f ");
+			writer.WriteUnsigned(vertexStart + indices[i] + 1);
+			writer.WriteText(" ");
+			writer.WriteUnsigned(vertexStart + indices[i + 1] + 1);
+			writer.WriteText(" ");
+			writer.WriteUnsigned(vertexStart + indices[i + 2] + 1);
+			writer.WriteText("\n");
+		}
+	} // OBJ indices start at one.
+
+	void WritePlyFaces(BufferedWriter& writer, std::vector<int>& indices, int firstTriangle, int triangleCount, size_t vertexStart)
+	{
+		for (int i = firstTriangle * 3; i < (firstTriangle + triangleCount) * 3; i += 3)
+		{
+			writer.WriteValue<uint8_t>(3);
+			writer.WriteValue<uint32_t>(uint32_t(vertexStart + indices[i]));
+			writer.WriteValue<uint32_t>(uint32_t(vertexStart + indices[i + 1]));
+			writer.WriteValue<uint32_t>(uint32_t(vertexStart + indices[i + 2]));
+		}
+	}
+
+	void WritePositions(BufferedWriter& writer, std::vector<glm::vec3>& positions, float offsetY)
+	{
+		for (unsigned int i = 0; i < positions.size(); i++)
+		{
+			writer.WriteValue<float>(positions[i].x);
+			writer.WriteValue<float>(positions[i].y + offsetY);
+			writer.WriteValue<float>(positions[i].z);
+		}
+	}
+
+	void WriteIndices(BufferedWriter& writer, std::vector<int>& indices, int firstTriangle, int triangleCount)
+	{
+		writer.Write(indices.data() + firstTriangle * 3, size_t(triangleCount) * 3 * sizeof(uint32_t));
+	} // Indices are never negative, so the ints can be written as they are.
+
+	void AddGlbMesh(const char* name, std::vector<glm::vec3>& positions, size_t positionBytes, size_t byteOffset, bool walls, std::string& meshes, std::string& bufferViews,
+		std::string& accessors, int& accessorCount)
+	{
+		glm::vec3 minimum = positions.empty() ? glm::vec3(0.0f) : positions[0];
+		glm::vec3 maximum = minimum;
+		for (unsigned int i = 1; i < positions.size(); i++)
+		{
+			minimum = glm::min(minimum, positions[i]);
+			maximum = glm::max(maximum, positions[i]);
+		}
+
+		int bufferViewIndex = std::count(bufferViews.begin(), bufferViews.end(), '{');
+		AddJson(bufferViews, FormatText("{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu,\"byteStride\":12,\"target\":34962}", byteOffset, positionBytes));
+		size_t indexBytes = (walls ? mesh.wallTriangles.size() : mesh.triangles.size()) * sizeof(uint32_t);
+		AddJson(bufferViews, FormatText("{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu,\"target\":34963}", byteOffset + positionBytes, indexBytes));
+
+		int positionAccessor = accessorCount++;
+		AddJson(accessors, FormatText("{\"bufferView\":%d,\"componentType\":5126,\"count\":%zu,\"type\":\"VEC3\",\"min\":[%.9g,%.9g,%.9g],\"max\":[%.9g,%.9g,%.9g]}",
+			bufferViewIndex, positions.size(), minimum.x, minimum.y, minimum.z, maximum.x, maximum.y, maximum.z));
+
+		std::string primitives = "";
+		for (unsigned int i = 0; i < mesh.chunks.size(); i++)
+		{
+			int firstTriangle = walls ? mesh.chunks[i].firstWallTriangle : mesh.chunks[i].firstTriangle;
+			int triangleCount = walls ? mesh.chunks[i].wallTriangleCount : mesh.chunks[i].triangleCount;
+			if (triangleCount == 0)
+			{
+				continue;
+			}
+			AddJson(accessors, FormatText("{\"bufferView\":%d,\"byteOffset\":%zu,\"componentType\":5125,\"count\":%d,\"type\":\"SCALAR\"}",
+				bufferViewIndex + 1, size_t(firstTriangle) * 3 * sizeof(uint32_t), triangleCount * 3));
+			AddJson(primitives, FormatText("{\"attributes\":{\"POSITION\":%d},\"indices\":%d}", positionAccessor, accessorCount++));
+		}
+		AddJson(meshes, FormatText("{\"name\":\"%s\",\"primitives\":[", name) + primitives + "]}");
+	} // Adds a mesh whose positions and chunk indices sit at byteOffset in the binary chunk, one primitive per chunk that has triangles.
+
+	static void AddJson(std::string& list, const std::string& item)
+	{
+		if (!list.empty())
+		{
+			list += ",";
+		}
+		list += item;
+	}
+
+	static std::string FormatText(const char* format, ...)
+	{
+		char text[512];
+		va_list arguments;
+		va_start(arguments, format);
+		vsnprintf(text, sizeof(text), format, arguments);
+		va_end(arguments);
+		return text;
+	}
+};
+
+#endif
@@ -1,32 +1,40 @@
 #ifndef MESH_CLASS
 #define MESH_CLASS
 
-#include <GL/glew.h>
 #include <glm/glm.hpp>
+#include <cstdint>
 #include <vector>
 #include <map>
 #include <unordered_set>
+#include <cmath>
+#include <algorithm>
 
 #include "triangle_struct.h"
+#include "mesh_chunk.h"
+#include "pipeline_profiler.h"
 
 class Node 
 {
 public:
 	glm::vec3 position;
 	int vertexIndex;
+	int nodeIndex;
 
 	Node() 
 	{
 		Node::position = glm::vec3(0.0f, 0.0f, 0.0f);
 		Node::vertexIndex = -1;
+		Node::nodeIndex = -1;
 	}
 
-	Node(glm::vec3 position) 
+	Node(glm::vec3 position, int nodeIndex = -1) 
 	{
 		Node::position = position;
 		Node::vertexIndex = -1;
+		Node::nodeIndex = nodeIndex;
 	}
-}; // Each square will have 8 nodes, 4 control nodes and 4 normal nodes. These nodes are used for calculating the squares configuration and drawing the appropriate shape.
+}; // Each square will have 8 nodes, 4 control nodes and 4 normal nodes. These nodes are used for drawing the appropriate shape.
+   // The node index identifies the node within the whole grid, squares hold copies of their nodes so this is what lets neighbouring squares share a vertex.
 
 class ControlNode: public Node
 {
@@ -41,24 +49,25 @@ public:
 		ControlNode::above = Node(position + glm::vec3(0.0f, 1.0f, 0.0f) * 1.0f / 2.0f);
 		ControlNode::right = Node(position + glm::vec3(1.0f, 0.0f, 0.0f) * 1.0f / 2.0f);
 		ControlNode::vertexIndex = -1;
+		ControlNode::nodeIndex = -1;
 	}
 
-	ControlNode(glm::vec3 position, bool active, float squareSize) 
+	ControlNode(glm::vec3 position, bool active, float squareSize, int gridIndex = -1) 
 	{
 		ControlNode::position = position;
 		ControlNode::active = active;
-		ControlNode::above = Node(position + glm::vec3(0.0f, 0.0f, 1.0f) * squareSize / 2.0f);
-		ControlNode::right = Node(position + glm::vec3(1.0f, 0.0f, 0.0f) * squareSize / 2.0f);
+		ControlNode::above = Node(position + glm::vec3(0.0f, 0.0f, 1.0f) * squareSize / 2.0f, gridIndex == -1 ? -1 : gridIndex * 3 + 1);
+		ControlNode::right = Node(position + glm::vec3(1.0f, 0.0f, 0.0f) * squareSize / 2.0f, gridIndex == -1 ? -1 : gridIndex * 3 + 2);
 		ControlNode::vertexIndex = -1;
+		ControlNode::nodeIndex = gridIndex == -1 ? -1 : gridIndex * 3;
 	}
-}; // The control nodes are used for calculating the configuration of the parent square, normal nodes are exclusively used for drawing.
+}; // The control nodes say whether their corner of the parent square is active, normal nodes are exclusively used for drawing.
 
 class Square 
 {
 public:
 	ControlNode topLeft, topRight, bottomRight, bottomLeft;
 	Node centerTop, centerRight, centerBottom, centerLeft;
-	int configuration;
 
 	Square() 
 	{
@@ -71,8 +80,6 @@ public:
 		centerRight = Node();
 		centerBottom = Node();
 		centerLeft = Node();
-
-		CalculateConfiguration();
 	}
 
 	Square(ControlNode topLeft, ControlNode topRight, ControlNode bottomRight, ControlNode bottomLeft)
@@ -86,65 +93,83 @@ public:
 		centerRight = bottomRight.above;
 		centerBottom = bottomLeft.right;
 		centerLeft = bottomLeft.above;
-
-		CalculateConfiguration();
-	}
-
-	void CalculateConfiguration() 
-	{
-		configuration = 0;
-		if (topLeft.active)
-			configuration += 8;
-		if (topRight.active)
-			configuration += 4;
-		if (bottomRight.active)
-			configuration += 2;
-		if (bottomLeft.active)
-			configuration += 1;
 	}
-}; // Square class, for each spot in the map there is a square object, and each one is compared with its neighbours to get the correct configuration.
+}; // Square class, the four control nodes around a spot in the map and the four nodes between them. Only built by SquareGrid when something needs a square's
+   // nodes together, triangulation works from the configurations and the grid positions of the nodes.
 
 class SquareGrid 
 {
 public:
-	std::vector<std::vector<Square>> squares;
+	// The map packed into bits, one per node. Each column of nodes is wordCount 64 bit words, bit y of the column is node y.
+	std::vector<uint64_t> activeNodes;
+	int nodeCountX;
+	int nodeCountY;
+	int wordCount;
+	float squareSize;
 
 	SquareGrid() 
 	{
-		squares = std::vector<std::vector<Square>>();
+		activeNodes = std::vector<uint64_t>();
+		nodeCountX = 0;
+		nodeCountY = 0;
+		wordCount = 0;
+		squareSize = 1.0f;
 	}
 
-	SquareGrid(std::vector<std::vector<int>> map, float squareSize)
+	SquareGrid(const std::vector<std::vector<int>>& map, float squareSize)
 	{
-		int nodeCountX = map.size();
-		if (nodeCountX != 0) 
-		{
-			int nodeCountY = map[map.size() - 1].size();
-			float mapWidth = nodeCountX * squareSize;
-			float mapHeight = nodeCountY * squareSize;
-
-			std::vector<std::vector<ControlNode>> controlNodes = std::vector<std::vector<ControlNode>>(nodeCountX, std::vector<ControlNode>(nodeCountY));;
-
-			for (int x = 0; x < nodeCountX; x++) 
-			{
-				for (int y = 0; y < nodeCountY; y++)
-				{
-					glm::vec3 pos = glm::vec3(mapWidth/2 + x * squareSize + squareSize/2, 0.0f, -mapHeight/2 + y * squareSize + squareSize/2);
-					controlNodes[x][y] = ControlNode(pos, map[x][y] == 1, squareSize);
-				}
-			}
+		SquareGrid::squareSize = squareSize;
+		nodeCountX = map.size();
+		nodeCountY = nodeCountX == 0 ? 0 : map[map.size() - 1].size();
+		wordCount = (nodeCountY + 63) / 64;
 
-			squares = std::vector<std::vector<Square>>(nodeCountX - 1, std::vector<Square>(nodeCountY - 1));
-			for (int x = 0; x < nodeCountX - 1; x++)
+		activeNodes = std::vector<uint64_t>(nodeCountX * wordCount, 0);
+		for (int x = 0; x < nodeCountX; x++) 
+		{
+			for (int y = 0; y < nodeCountY; y++)
 			{
-				for (int y = 0; y < nodeCountY - 1; y++)
+				if (map[x][y] == 1)
 				{
-					squares[x][y] = Square(controlNodes[x][y + 1], controlNodes[x + 1][y + 1], controlNodes[x + 1][y], controlNodes[x][y]);
+					activeNodes[x * wordCount + y / 64] |= uint64_t(1) << (y % 64);
 				}
 			}
 		}
 	}
-}; // This class creates and holds all the squares (these squares hold the control and normal nodes) given a map vector and squaresize. 
+
+	int GetSquareCountX()
+	{
+		return nodeCountX < 2 || nodeCountY < 2 ? 0 : nodeCountX - 1;
+	}
+
+	int GetSquareCountY()
+	{
+		return nodeCountX < 2 || nodeCountY < 2 ? 0 : nodeCountY - 1;
+	} // A grid with fewer than two nodes along either side has no squares at all.
+
+	bool IsActive(int x, int y)
+	{
+		return (activeNodes[x * wordCount + y / 64] >> (y % 64)) & 1;
+	}
+
+	glm::vec3 GetNodePosition(int x, int y)
+	{
+		float mapWidth = nodeCountX * squareSize;
+		float mapHeight = nodeCountY * squareSize;
+		return glm::vec3(mapWidth/2 + x * squareSize + squareSize/2, 0.0f, -mapHeight/2 + y * squareSize + squareSize/2);
+	} // Position of the control node at a grid position, it need not be inside the grid.
+
+	ControlNode GetControlNode(int x, int y)
+	{
+		bool active = x >= 0 && x < nodeCountX && y >= 0 && y < nodeCountY && IsActive(x, y);
+		return ControlNode(GetNodePosition(x, y), active, squareSize, x * nodeCountY + y);
+	}
+
+	Square GetSquare(int x, int y)
+	{
+		return Square(GetControlNode(x, y + 1), GetControlNode(x + 1, y + 1), GetControlNode(x + 1, y), GetControlNode(x, y));
+	}
+}; // Holds the map as one bit per node and hands out the control nodes and squares on it when they are asked for, nothing is kept for each square. A node's
+   // position and index come from where it is in the grid, so the same node is identical whichever square it is built for.
 
 class MeshGenerator 
 {
@@ -164,230 +189,1067 @@ public:
 	std::vector<std::vector<int>> outlines;	
 	std::unordered_set<int> checkedVertices; // Store which vertices have already been checked.
 
-	MeshGenerator(std::vector<std::vector<int>> map, float squareSize) 
+	// Vertices first made for a square that has both active and inactive corners, in the order they were made. Such squares only exist in mixed blocks, and
+	// every other vertex is marked as checked by the solid square or rectangle that made it, so these are the only vertices an outline can start from.
+	std::vector<int> outlineCandidates;
+
+	// Vertex index of every node in the grid, -1 until the node is first used. Every square touching the node shares that vertex, which is what lets the
+	// outline search see where one square's triangles meet the next and follow the contour rather than each square's own edges.
+	std::vector<int> nodeVertexIndices;
+
+	// Marching squares case of every square, x major like the grid. Worked out 64 squares at a time from the map packed into bits, so triangulation can pick
+	// out the squares with something to draw without reading the much larger Square objects.
+	std::vector<uint8_t> configurations;
+	size_t activeNodeCount; // Nodes of the map that are active.
+	size_t crossedEdgeCount; // Edges between neighbouring nodes where one is active and the other is not, each has a vertex at its middle.
+
+	// Whether each blockSize by blockSize block of squares is all floor, all wall, or both, so uniform blocks can be passed over or meshed without looking at
+	// each square's configuration.
+	std::vector<int> blockStates;
+	int blockCountX;
+	int blockCountY;
+
+	// Blocks of squares whose triangles sit next to each other in the floor and wall buffers.
+	std::vector<MeshChunk> chunks;
+	int chunkCountX;
+	int chunkCountY;
+
+	bool greedyMerge; // Merge runs of fully active squares into larger rectangles rather than two triangles per square.
+	bool simplifyOutlines; // Drop outline vertices that lie on a straight run before the walls are extruded.
+	float outlineTolerance; // How far a simplified outline may stray from the original, 0 only removes collinear vertices.
+	int chunkSize; // Squares along each side of a chunk, 0 keeps the whole grid in one chunk.
+	bool chunkSkirts; // Hang a wall down every chunk edge the floor reaches, hides gaps between chunks drawn at different levels of detail.
+	float squareSize;
+	float wallHeight;
+
+	static const int floorVertexFloats = 6; // Position and colour.
+	static const int wallVertexFloats = 5; // Position and texture coordinates.
+
+	enum
+	{
+		blockSize = 8,
+		blockEmpty = 0, // No square in the block has an active corner, so it has no triangles.
+		blockSolid = 1, // Every square in the block is configuration 15.
+		blockMixed = 2
+	}; // An enum rather than static consts, std::vector and std::count take these by reference, which needs a definition a header only class cannot give.
+
+	MeshGenerator(const std::vector<std::vector<int>>& map, float squareSize, bool greedyMerge = false, bool simplifyOutlines = false, float outlineTolerance = 0.0f, int chunkSize = 0, bool chunkSkirts = false) 
 	{
 		triangleDictionary = std::map<int, std::vector<Triangle>>();
 		outlines = std::vector<std::vector<int>>();
 		checkedVertices = std::unordered_set<int>();
+		outlineCandidates = std::vector<int>();
+		chunks = std::vector<MeshChunk>();
+		configurations = std::vector<uint8_t>();
+		activeNodeCount = 0;
+		crossedEdgeCount = 0;
+		blockStates = std::vector<int>();
+		MeshGenerator::greedyMerge = greedyMerge;
+		MeshGenerator::simplifyOutlines = simplifyOutlines;
+		MeshGenerator::outlineTolerance = outlineTolerance;
+		MeshGenerator::chunkSize = chunkSize;
+		MeshGenerator::chunkSkirts = chunkSkirts;
+		MeshGenerator::wallHeight = 5;
 		GenerateMesh(map, squareSize);
-	}
+	} // The map is only read while the mesh is built, it is never copied and need not outlive the constructor.
 
-	void CreateFinalVerticesLists(std::vector<std::vector<GLfloat>>& finalVerticesFloor, std::vector<std::vector<GLfloat>>& finalVerticesWalls)
+	void CreateFinalVertexBuffers(std::vector<float>& finalVerticesFloor, std::vector<float>& finalVerticesWalls)
 	{
-		for (unsigned int i = 0; i < triangles.size() / 3; i++)
+		ScopedTimer timer("Vertex lists");
+
+		finalVerticesFloor.reserve(finalVerticesFloor.size() + triangles.size() * floorVertexFloats);
+		for (unsigned int i = 0; i < triangles.size(); i++)
 		{
-			finalVerticesFloor.push_back(std::vector<GLfloat>());
+			glm::vec3 vertex = vertices[triangles[i]];
+			finalVerticesFloor.push_back(vertex.x);
+			finalVerticesFloor.push_back(vertex.y);
+			finalVerticesFloor.push_back(vertex.z);
+			finalVerticesFloor.push_back(0.22f);
+			finalVerticesFloor.push_back(0.22f);
+			finalVerticesFloor.push_back(0.22f);
 		}
-		for (unsigned int i = 0; i < finalVerticesFloor.size(); i++)
-		{
-			finalVerticesFloor[i].push_back(vertices[triangles[(i * 3)]].x);
-			finalVerticesFloor[i].push_back(vertices[triangles[(i * 3)]].y);
-			finalVerticesFloor[i].push_back(vertices[triangles[(i * 3)]].z);
-			finalVerticesFloor[i].push_back(0.22f);
-			finalVerticesFloor[i].push_back(0.22f);
-			finalVerticesFloor[i].push_back(0.22f);
 
-			finalVerticesFloor[i].push_back(vertices[triangles[(i * 3) + 1]].x);
-			finalVerticesFloor[i].push_back(vertices[triangles[(i * 3) + 1]].y);
-			finalVerticesFloor[i].push_back(vertices[triangles[(i * 3) + 1]].z);
-			finalVerticesFloor[i].push_back(0.22f);
-			finalVerticesFloor[i].push_back(0.22f);
-			finalVerticesFloor[i].push_back(0.22f);
-
-			finalVerticesFloor[i].push_back(vertices[triangles[(i * 3) + 2]].x);
-			finalVerticesFloor[i].push_back(vertices[triangles[(i * 3) + 2]].y);
-			finalVerticesFloor[i].push_back(vertices[triangles[(i * 3) + 2]].z);
-			finalVerticesFloor[i].push_back(0.22f);
-			finalVerticesFloor[i].push_back(0.22f);
-			finalVerticesFloor[i].push_back(0.22f);
+		static const float wallUVs[] = { 1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f };
+		finalVerticesWalls.reserve(finalVerticesWalls.size() + wallTriangles.size() * wallVertexFloats);
+		for (unsigned int i = 0; i < wallTriangles.size(); i++)
+		{
+			glm::vec3 vertex = wallVertices[wallTriangles[i]];
+			finalVerticesWalls.push_back(vertex.x);
+			finalVerticesWalls.push_back(vertex.y);
+			finalVerticesWalls.push_back(vertex.z);
+			finalVerticesWalls.push_back(wallUVs[(i % 3) * 2]);
+			finalVerticesWalls.push_back(wallUVs[(i % 3) * 2 + 1]);
 		}
+		PipelineProfiler::Get().AddCount("Vertex list bytes", (triangles.size() * floorVertexFloats + wallTriangles.size() * wallVertexFloats) * sizeof(float));
+	} // Creates the interleaved vertex arrays the renderer uploads, three vertices per triangle. Floor vertices are a position and a colour, wall vertices a position
+	  // and texture coordinates.
 
-		for (unsigned int i = 0; i < wallTriangles.size() / 3; i++)
+	void CreateIndexedBuffers(std::vector<float>& floorPositions, std::vector<uint32_t>& floorIndices, std::vector<float>& wallPositions, std::vector<uint32_t>& wallIndices)
+	{
+		floorPositions = std::vector<float>();
+		floorPositions.reserve(vertices.size() * 3);
+		for (unsigned int i = 0; i < vertices.size(); i++)
 		{
-			finalVerticesWalls.push_back(std::vector<GLfloat>());
+			floorPositions.push_back(vertices[i].x);
+			floorPositions.push_back(vertices[i].y);
+			floorPositions.push_back(vertices[i].z);
 		}
-		for (unsigned int i = 0; i < finalVerticesWalls.size(); i++)
-		{
-			finalVerticesWalls[i].push_back(wallVertices[wallTriangles[(i * 3)]].x);
-			finalVerticesWalls[i].push_back(wallVertices[wallTriangles[(i * 3)]].y);
-			finalVerticesWalls[i].push_back(wallVertices[wallTriangles[(i * 3)]].z);
-			finalVerticesWalls[i].push_back(1.0f);
-			finalVerticesWalls[i].push_back(1.0f);
-
-			finalVerticesWalls[i].push_back(wallVertices[wallTriangles[(i * 3) + 1]].x);
-			finalVerticesWalls[i].push_back(wallVertices[wallTriangles[(i * 3) + 1]].y);
-			finalVerticesWalls[i].push_back(wallVertices[wallTriangles[(i * 3) + 1]].z);
-			finalVerticesWalls[i].push_back(1.0f);
-			finalVerticesWalls[i].push_back(0.0f);
+		floorIndices = std::vector<uint32_t>(triangles.begin(), triangles.end());
 
-			finalVerticesWalls[i].push_back(wallVertices[wallTriangles[(i * 3) + 2]].x);
-			finalVerticesWalls[i].push_back(wallVertices[wallTriangles[(i * 3) + 2]].y);
-			finalVerticesWalls[i].push_back(wallVertices[wallTriangles[(i * 3) + 2]].z);
-			finalVerticesWalls[i].push_back(0.0f);
-			finalVerticesWalls[i].push_back(1.0f);
-		} 
-	} // Creates the vertex arrays that opengl can use to generate the cave system.
+		wallPositions = std::vector<float>();
+		wallPositions.reserve(wallVertices.size() * 3);
+		for (unsigned int i = 0; i < wallVertices.size(); i++)
+		{
+			wallPositions.push_back(wallVertices[i].x);
+			wallPositions.push_back(wallVertices[i].y);
+			wallPositions.push_back(wallVertices[i].z);
+		}
+		wallIndices = std::vector<uint32_t>(wallTriangles.begin(), wallTriangles.end());
+	} // Shared positions and triangle indices without any per vertex attributes, for tools that want the mesh itself rather than something to draw.
 
-	void GenerateMesh(std::vector<std::vector<int>> map, float squareSize) 
+	void GenerateMesh(const std::vector<std::vector<int>>& map, float squareSize) 
 	{
 
 		triangleDictionary.clear();
 		outlines.clear();
 		checkedVertices.clear();
+		outlineCandidates.clear();
+		chunks.clear();
 
-		squareGrid = SquareGrid(map, squareSize);
+		{
+			ScopedTimer timer("SquareGrid");
+			squareGrid = SquareGrid(map, squareSize);
+		}
+		{
+			ScopedTimer timer("Configurations");
+			CalculateConfigurations();
+		}
+		nodeVertexIndices = std::vector<int>(squareGrid.nodeCountX * squareGrid.nodeCountY * 3, -1);
+		MeshGenerator::squareSize = squareSize;
 
 		vertices = std::vector<glm::vec3>();
 		triangles = std::vector<int>();
 
-		for (unsigned int x = 0; x < squareGrid.squares.size(); x++) 
+		int squaresPerChunk = GetSquaresPerChunk();
+		chunkCountX = (GetSquareCountX() + squaresPerChunk - 1) / squaresPerChunk;
+		chunkCountY = (GetSquareCountY() + squaresPerChunk - 1) / squaresPerChunk;
+
 		{
-			for (int y = 0; y < squareGrid.squares[x].size(); y++)
+			ScopedTimer timer("Triangulation");
+			std::vector<std::vector<glm::ivec4>> chunkRectangles = std::vector<std::vector<glm::ivec4>>(chunkCountX * chunkCountY);
+			std::vector<std::vector<bool>> usedNodes = std::vector<std::vector<bool>>();
+			if (greedyMerge)
+			{
+				FindSolidRectangles(chunkRectangles, usedNodes);
+			}
+			ReserveFloorBuffers(chunkRectangles, usedNodes);
+			outlineCandidates.reserve(crossedEdgeCount);
+
+			for (int chunkX = 0; chunkX < chunkCountX; chunkX++)
 			{
-				TriangulateSquare(squareGrid.squares[x][y]);
+				for (int chunkY = 0; chunkY < chunkCountY; chunkY++)
+				{
+					glm::ivec4 area = GetChunkArea(chunkX, chunkY);
+					MeshChunk chunk = MeshChunk();
+					chunk.firstTriangle = triangles.size() / 3;
+
+					for (int x = area.x; x < area.z; x++)
+					{
+						int y = area.y;
+						while (y < area.w)
+						{
+							int blockState = GetBlockState(x, y);
+							int blockEndY = std::min((y / blockSize + 1) * blockSize, area.w);
+							if (blockState == blockSolid && !greedyMerge)
+							{
+								TriangulateSolidSquares(x, y, blockEndY);
+							}
+							else if (blockState == blockMixed)
+							{
+								for (int squareY = y; squareY < blockEndY; squareY++)
+								{
+									int configuration = GetConfiguration(x, squareY);
+									if (configuration == 0 || (greedyMerge && configuration == 15))
+									{
+										continue;
+									}
+									if (configuration == 15)
+									{
+										TriangulateSolidSquares(x, squareY, squareY + 1);
+									}
+									else
+									{
+										TriangulateSquare(x, squareY);
+									}
+								}
+							}
+							y = blockEndY;
+						}
+					}
+
+					std::vector<glm::ivec4>& rectangles = chunkRectangles[chunkX * chunkCountY + chunkY];
+					for (unsigned int i = 0; i < rectangles.size(); i++)
+					{
+						TriangulateRectangle(rectangles[i], usedNodes);
+					}
+
+					chunk.triangleCount = triangles.size() / 3 - chunk.firstTriangle;
+					chunk.boundsMin = squareGrid.GetNodePosition(area.x, area.y) - glm::vec3(0.0f, 1.0f, 0.0f) * wallHeight;
+					chunk.boundsMax = squareGrid.GetNodePosition(area.z, area.w);
+					chunks.push_back(chunk);
+				}
 			}
 		}
 
 		CreateWallMesh();
+
+		PipelineProfiler& profiler = PipelineProfiler::Get();
+		profiler.AddCount("Vertices", vertices.size() + wallVertices.size());
+		profiler.AddCount("Floor triangles", triangles.size() / 3);
+		profiler.AddCount("Wall triangles", wallTriangles.size() / 3);
+		profiler.AddCount("Outlines", outlines.size());
+		profiler.AddCount("Mesh bytes", (vertices.size() + wallVertices.size()) * sizeof(glm::vec3) + (triangles.size() + wallTriangles.size()) * sizeof(int)
+			+ nodeVertexIndices.size() * sizeof(int) + squareGrid.activeNodes.size() * sizeof(uint64_t) + configurations.size() + GetLookupBytes());
 	} // Firstly clears the dictionary, outline vector, and checked vertices set. Next it will check each individual square for its configuration before creating the final wall vectors.
+	  // Squares are visited a chunk at a time so every chunk's triangles end up together. When greedy merging, the fully active squares are skipped and meshed as rectangles instead.
+	  // Each column of a chunk is walked a block at a time, empty blocks are stepped over and solid ones meshed in bulk, in the same order as square by square.
+
+	void CalculateConfigurations()
+	{
+		static const SpreadTable table;
+
+		int squareCountX = GetSquareCountX();
+		int squareCountY = GetSquareCountY();
+		int nodeCountY = squareGrid.nodeCountY;
+		int wordCount = squareGrid.wordCount;
+		const std::vector<uint64_t>& packedMap = squareGrid.activeNodes;
+
+		activeNodeCount = 0;
+		crossedEdgeCount = 0;
+		for (int x = 0; x < squareGrid.nodeCountX; x++)
+		{
+			for (int word = 0; word < wordCount; word++)
+			{
+				uint64_t nodes = packedMap[x * wordCount + word];
+				uint64_t nextNodes = (nodes >> 1) | (word + 1 < wordCount ? packedMap[x * wordCount + word + 1] << 63 : 0);
+				int edgeCount = std::min(std::max(nodeCountY - 1 - word * 64, 0), 64);
+				uint64_t validEdges = edgeCount == 64 ? ~uint64_t(0) : (uint64_t(1) << edgeCount) - 1;
+				activeNodeCount += CountBits(nodes);
+				crossedEdgeCount += CountBits((nodes ^ nextNodes) & validEdges);
+				if (x + 1 < squareGrid.nodeCountX)
+				{
+					crossedEdgeCount += CountBits(nodes ^ packedMap[(x + 1) * wordCount + word]);
+				}
+			}
+		}
+
+		blockCountX = (squareCountX + blockSize - 1) / blockSize;
+		blockCountY = (squareCountY + blockSize - 1) / blockSize;
+		std::vector<bool> blockAllSolid = std::vector<bool>(blockCountX * blockCountY, true);
+		std::vector<bool> blockAnyActive = std::vector<bool>(blockCountX * blockCountY, false);
+		configurations = std::vector<uint8_t>(squareCountX * squareCountY, 0);
+
+		for (int x = 0; x < squareCountX; x++)
+		{
+			const uint64_t* left = packedMap.data() + x * wordCount;
+			const uint64_t* right = packedMap.data() + (x + 1) * wordCount;
+			for (int word = 0; word * 64 < squareCountY; word++)
+			{
+				uint64_t bottomLeft = left[word];
+				uint64_t bottomRight = right[word];
+				uint64_t topLeft = (left[word] >> 1) | (word + 1 < wordCount ? left[word + 1] << 63 : 0);
+				uint64_t topRight = (right[word] >> 1) | (word + 1 < wordCount ? right[word + 1] << 63 : 0);
+
+				int squareCount = std::min(squareCountY - word * 64, 64);
+				uint64_t validSquares = squareCount == 64 ? ~uint64_t(0) : (uint64_t(1) << squareCount) - 1;
+				uint64_t solidSquares = topLeft & topRight & bottomRight & bottomLeft & validSquares;
+				uint64_t activeSquares = (topLeft | topRight | bottomRight | bottomLeft) & validSquares;
+
+				uint8_t* configuration = &configurations[x * squareCountY + word * 64];
+				for (int group = 0; group < squareCount; group += 8)
+				{
+					if (((activeSquares >> group) & 0xFF) == 0)
+					{
+						continue;
+					}
+					uint64_t cases = table.bytes[(topLeft >> group) & 0xFF] << 3 | table.bytes[(topRight >> group) & 0xFF] << 2
+						| table.bytes[(bottomRight >> group) & 0xFF] << 1 | table.bytes[(bottomLeft >> group) & 0xFF];
+					int count = std::min(squareCount - group, 8);
+					for (int square = 0; square < count; square++)
+					{
+						configuration[group + square] = uint8_t(cases >> (square * 8));
+					}
+				}
+
+				for (int blockY = word * (64 / blockSize); blockY < blockCountY && blockY < (word + 1) * (64 / blockSize); blockY++)
+				{
+					int shift = (blockY * blockSize) % 64;
+					uint64_t blockSquares = (validSquares >> shift) & ((uint64_t(1) << blockSize) - 1);
+					int block = (x / blockSize) * blockCountY + blockY;
+					blockAllSolid[block] = blockAllSolid[block] && ((solidSquares >> shift) & blockSquares) == blockSquares;
+					blockAnyActive[block] = blockAnyActive[block] || ((activeSquares >> shift) & blockSquares) != 0;
+				}
+			}
+		}
+
+		blockStates = std::vector<int>(blockCountX * blockCountY, blockMixed);
+		for (unsigned int i = 0; i < blockStates.size(); i++)
+		{
+			if (!blockAnyActive[i])
+			{
+				blockStates[i] = blockEmpty;
+			}
+			else if (blockAllSolid[i])
+			{
+				blockStates[i] = blockSolid;
+			}
+		}
+		PipelineProfiler::Get().AddCount("Mixed blocks", std::count(blockStates.begin(), blockStates.end(), int(blockMixed)));
+	} // Works from the columns of the map SquareGrid packs into 64 bit words, one bit per node. A square's four corners are then its own column and the next,
+	  // each as they are and moved along by one node, so a single set of shifts and masks gives all four corners of 64 squares. The cases are then made eight
+	  // squares at a time, each corner's byte of bits is spread to one bit per square through a table and the four are shifted into place, so no square is
+	  // looked at on its own. Groups of eight with no active corner keep case 0 and are skipped, and the block mask comes from the same words. The active
+	  // nodes and the edges that cross the outline are counted from them too.
+
+	struct SpreadTable
+	{
+		uint64_t bytes[256];
+
+		SpreadTable()
+		{
+			for (int value = 0; value < 256; value++)
+			{
+				bytes[value] = 0;
+				for (int bit = 0; bit < 8; bit++)
+				{
+					bytes[value] |= uint64_t((value >> bit) & 1) << (bit * 8);
+				}
+			}
+		}
+	}; // Every possible byte with each of its bits moved to the bottom of a byte of its own, bit n to byte n.
+
+	static int CountBits(uint64_t bits)
+	{
+		bits = bits - ((bits >> 1) & 0x5555555555555555ull);
+		bits = (bits & 0x3333333333333333ull) + ((bits >> 2) & 0x3333333333333333ull);
+		bits = (bits + (bits >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+		return int((bits * 0x0101010101010101ull) >> 56);
+	} // Number of set bits, added up in pairs, then fours, then bytes.
+
+	void ReserveFloorBuffers(std::vector<std::vector<glm::ivec4>>& chunkRectangles, std::vector<std::vector<bool>>& usedNodes)
+	{
+		static const int caseTriangles[16] = { 0, 1, 1, 2, 1, 4, 2, 3, 1, 2, 4, 3, 2, 3, 3, 2 };
+
+		size_t triangleCount = 0;
+		for (unsigned int i = 0; i < configurations.size(); i++)
+		{
+			if (!greedyMerge || configurations[i] != 15)
+			{
+				triangleCount += caseTriangles[configurations[i]];
+			}
+		}
+
+		size_t vertexCount = crossedEdgeCount;
+		if (greedyMerge)
+		{
+			for (unsigned int i = 0; i < chunkRectangles.size(); i++)
+			{
+				for (unsigned int j = 0; j < chunkRectangles[i].size(); j++)
+				{
+					triangleCount += CountRectangleTriangles(chunkRectangles[i][j], usedNodes);
+				}
+			}
+			for (unsigned int x = 0; x < usedNodes.size(); x++)
+			{
+				vertexCount += std::count(usedNodes[x].begin(), usedNodes[x].end(), true);
+			}
+		}
+		else
+		{
+			vertexCount += activeNodeCount;
+		}
+
+		vertices.reserve(vertexCount);
+		triangles.reserve(triangleCount * 3);
+	} // Works out exactly how big the floor will be before any of it is made, so its buffers are allocated once rather than grown. Every square case has a fixed
+	  // number of triangles, and every vertex sits on an active node or in the middle of a crossed edge. When greedy merging, only the nodes a shape has a
+	  // vertex on are used, and each rectangle has two triangles fewer than the nodes around its edge.
+
+	int CountRectangleTriangles(glm::ivec4 rectangle, std::vector<std::vector<bool>>& usedNodes)
+	{
+		int startX = rectangle.x;
+		int startY = rectangle.y;
+		int endX = rectangle.z + 1;
+		int endY = rectangle.w + 1;
+
+		int edgeNodes = 4;
+		for (int x = startX + 1; x < endX; x++)
+		{
+			edgeNodes += usedNodes[x][endY] ? 1 : 0;
+			edgeNodes += usedNodes[x][startY] ? 1 : 0;
+		}
+		for (int y = startY + 1; y < endY; y++)
+		{
+			edgeNodes += usedNodes[startX][y] ? 1 : 0;
+			edgeNodes += usedNodes[endX][y] ? 1 : 0;
+		}
+		return edgeNodes - 2;
+	} // The same nodes TriangulateRectangle keeps along each edge.
+
+	int GetConfiguration(int squareX, int squareY)
+	{
+		return configurations[squareX * GetSquareCountY() + squareY];
+	}
+
+	int GetBlockState(int squareX, int squareY)
+	{
+		return blockStates[(squareX / blockSize) * blockCountY + squareY / blockSize];
+	}
+
+	void TriangulateSolidSquares(int x, int startY, int endY)
+	{
+		for (int y = startY; y < endY; y++)
+		{
+			int topLeft = GetNodeVertex(x, y + 1);
+			int topRight = GetNodeVertex(x + 1, y + 1);
+			int bottomRight = GetNodeVertex(x + 1, y);
+			int bottomLeft = GetNodeVertex(x, y);
+
+			triangles.push_back(topLeft);
+			triangles.push_back(topRight);
+			triangles.push_back(bottomRight);
+			triangles.push_back(topLeft);
+			triangles.push_back(bottomRight);
+			triangles.push_back(bottomLeft);
+
+			checkedVertices.insert(topLeft);
+			checkedVertices.insert(topRight);
+			checkedVertices.insert(bottomRight);
+			checkedVertices.insert(bottomLeft);
+		}
+	} // Meshes a run of fully active squares down one column exactly as TriangulateSquare would, without building each square. Their triangles are left out of the
+	  // triangle dictionary, every corner is marked as checked so the outline search never looks them up.
+
+	int GetNodeVertex(int x, int y, int kind = 0)
+	{
+		static const glm::vec3 offsets[3] = { glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(1.0f, 0.0f, 0.0f) };
+
+		int& vertexIndex = nodeVertexIndices[(x * squareGrid.nodeCountY + y) * 3 + kind];
+		if (vertexIndex == -1)
+		{
+			vertexIndex = vertices.size();
+			vertices.push_back(squareGrid.GetNodePosition(x, y) + offsets[kind] * squareGrid.squareSize / 2.0f);
+		}
+		return vertexIndex;
+	} // The vertex for a node of the grid, made the first time any square asks for it. Kind 0 is the control node at the grid position, 1 the node above it
+	  // and 2 the node to its right, numbered and placed the same way ControlNode does.
+
+	size_t GetLookupBytes()
+	{
+		size_t bytes = triangleDictionary.size() * (sizeof(std::pair<const int, std::vector<Triangle>>) + 4 * sizeof(void*));
+		for (std::map<int, std::vector<Triangle>>::iterator entry = triangleDictionary.begin(); entry != triangleDictionary.end(); entry++)
+		{
+			bytes += entry->second.capacity() * sizeof(Triangle);
+		}
+		bytes += checkedVertices.size() * (sizeof(int) + 2 * sizeof(void*)) + checkedVertices.bucket_count() * sizeof(void*);
+		bytes += outlineCandidates.capacity() * sizeof(int);
+		return bytes;
+	} // Roughly what the triangle dictionary, the checked vertex set and the outline candidates hold, counting a tree node for each dictionary entry and a list
+	  // node for each vertex.
+
+	void Translate(glm::vec3 offset)
+	{
+		for (unsigned int i = 0; i < vertices.size(); i++)
+		{
+			vertices[i] += offset;
+		}
+		for (unsigned int i = 0; i < wallVertices.size(); i++)
+		{
+			wallVertices[i] += offset;
+		}
+		for (unsigned int i = 0; i < chunks.size(); i++)
+		{
+			chunks[i].boundsMin += offset;
+			chunks[i].boundsMax += offset;
+		}
+	} // Moves the finished mesh, used to line coarser levels of detail up with the full resolution grid.
+
+	int GetSquareCountX()
+	{
+		return squareGrid.GetSquareCountX();
+	}
+
+	int GetSquareCountY()
+	{
+		return squareGrid.GetSquareCountY();
+	}
+
+	int GetSquaresPerChunk()
+	{
+		if (chunkSize > 0)
+		{
+			return chunkSize;
+		}
+		return std::max(std::max(GetSquareCountX(), GetSquareCountY()), 1);
+	}
+
+	glm::ivec4 GetChunkArea(int chunkX, int chunkY)
+	{
+		int squaresPerChunk = GetSquaresPerChunk();
+		return glm::ivec4(chunkX * squaresPerChunk, chunkY * squaresPerChunk, std::min((chunkX + 1) * squaresPerChunk, GetSquareCountX()), std::min((chunkY + 1) * squaresPerChunk, GetSquareCountY()));
+	} // Returns the first square of the chunk in x and y, followed by the square after its last in z and w.
+
+	int GetChunkIndex(glm::vec3 position)
+	{
+		glm::vec3 origin = squareGrid.GetNodePosition(0, 0);
+		int squareX = std::min(std::max(int(std::floor((position.x - origin.x) / squareSize)), 0), GetSquareCountX() - 1);
+		int squareY = std::min(std::max(int(std::floor((position.z - origin.z) / squareSize)), 0), GetSquareCountY() - 1);
+		return (squareX / GetSquaresPerChunk()) * chunkCountY + squareY / GetSquaresPerChunk();
+	} // Finds which chunk a position on the grid falls in.
+
+	void FindSolidRectangles(std::vector<std::vector<glm::ivec4>>& chunkRectangles, std::vector<std::vector<bool>>& usedNodes)
+	{
+		int squareCountX = GetSquareCountX();
+		int squareCountY = GetSquareCountY();
+
+		std::vector<std::vector<bool>> merged = std::vector<std::vector<bool>>(squareCountX, std::vector<bool>(squareCountY, false));
+		usedNodes = std::vector<std::vector<bool>>(squareGrid.nodeCountX, std::vector<bool>(squareGrid.nodeCountY, false));
+
+		for (int x = 0; x < squareCountX; x++)
+		{
+			for (int y = 0; y < squareCountY; y++)
+			{
+				if (GetBlockState(x, y) != blockMixed)
+				{
+					y = std::min((y / blockSize + 1) * blockSize, squareCountY) - 1;
+					continue;
+				}
+				int configuration = GetConfiguration(x, y);
+				if (configuration != 15)
+				{
+					usedNodes[x][y + 1] = usedNodes[x][y + 1] || (configuration & 8) != 0;
+					usedNodes[x + 1][y + 1] = usedNodes[x + 1][y + 1] || (configuration & 4) != 0;
+					usedNodes[x + 1][y] = usedNodes[x + 1][y] || (configuration & 2) != 0;
+					usedNodes[x][y] = usedNodes[x][y] || (configuration & 1) != 0;
+				}
+			}
+		}
+
+		for (int chunkX = 0; chunkX < chunkCountX; chunkX++)
+		{
+			for (int chunkY = 0; chunkY < chunkCountY; chunkY++)
+			{
+				glm::ivec4 area = GetChunkArea(chunkX, chunkY);
+				for (int x = area.x; x < area.z; x++)
+				{
+					for (int y = area.y; y < area.w; y++)
+					{
+						if (GetBlockState(x, y) == blockEmpty)
+						{
+							y = std::min((y / blockSize + 1) * blockSize, area.w) - 1;
+							continue;
+						}
+						if (GetConfiguration(x, y) != 15 || merged[x][y])
+						{
+							continue;
+						}
+
+						int endY = y;
+						while (endY + 1 < area.w && GetConfiguration(x, endY + 1) == 15 && !merged[x][endY + 1])
+						{
+							endY++;
+						}
+
+						int endX = x;
+						bool canGrow = true;
+						while (canGrow && endX + 1 < area.z)
+						{
+							for (int runY = y; runY <= endY; runY++)
+							{
+								if (GetConfiguration(endX + 1, runY) != 15 || merged[endX + 1][runY])
+								{
+									canGrow = false;
+									break;
+								}
+							}
+							if (canGrow)
+							{
+								endX++;
+							}
+						}
+
+						for (int runX = x; runX <= endX; runX++)
+						{
+							for (int runY = y; runY <= endY; runY++)
+							{
+								merged[runX][runY] = true;
+							}
+						}
+						usedNodes[x][y] = true;
+						usedNodes[endX + 1][y] = true;
+						usedNodes[x][endY + 1] = true;
+						usedNodes[endX + 1][endY + 1] = true;
+						chunkRectangles[chunkX * chunkCountY + chunkY].push_back(glm::ivec4(x, y, endX, endY));
+					}
+				}
+			}
+		}
+	} // Greedily grows each unmerged fully active square into the largest run down its column, then widens that run across as many columns as it fits, 
+	  // never leaving its chunk. Every node another shape has a vertex on is recorded so the rectangles can include those nodes along their edges. Only mixed
+	  // blocks can hold such a node, and empty blocks cannot start a rectangle.
+
+	void TriangulateRectangle(glm::ivec4 rectangle, std::vector<std::vector<bool>>& usedNodes)
+	{
+		int startX = rectangle.x;
+		int startY = rectangle.y;
+		int endX = rectangle.z + 1;
+		int endY = rectangle.w + 1;
+
+		std::vector<Node> top = std::vector<Node>();
+		std::vector<Node> bottom = std::vector<Node>();
+		std::vector<Node> left = std::vector<Node>();
+		std::vector<Node> right = std::vector<Node>();
+
+		for (int x = startX; x <= endX; x++)
+		{
+			if (x == startX || x == endX || usedNodes[x][endY])
+			{
+				top.push_back(squareGrid.GetControlNode(x, endY));
+			}
+			if (x == startX || x == endX || usedNodes[x][startY])
+			{
+				bottom.push_back(squareGrid.GetControlNode(x, startY));
+			}
+		}
+		for (int y = startY + 1; y < endY; y++)
+		{
+			if (usedNodes[startX][y])
+			{
+				left.push_back(squareGrid.GetControlNode(startX, y));
+			}
+			if (usedNodes[endX][y])
+			{
+				right.push_back(squareGrid.GetControlNode(endX, y));
+			}
+		}
+
+		AssignVertices(top);
+		AssignVertices(bottom);
+		AssignVertices(left);
+		AssignVertices(right);
+
+		std::vector<Node> leftFan = std::vector<Node>();
+		leftFan.push_back(bottom[0]);
+		leftFan.insert(leftFan.end(), left.begin(), left.end());
+		leftFan.push_back(top[0]);
+		for (unsigned int i = 0; i < leftFan.size() - 1; i++)
+		{
+			CreateTriangle(bottom[1], leftFan[i], leftFan[i + 1]);
+		}
+
+		std::vector<Node> rightFan = std::vector<Node>();
+		rightFan.push_back(top[top.size() - 1]);
+		rightFan.insert(rightFan.end(), right.rbegin(), right.rend());
+		rightFan.push_back(bottom[bottom.size() - 1]);
+		for (unsigned int i = 0; i < rightFan.size() - 1; i++)
+		{
+			CreateTriangle(top[top.size() - 2], rightFan[i], rightFan[i + 1]);
+		}
+
+		int topIndex = 0;
+		int bottomIndex = 1;
+		int topEnd = top.size() - 2;
+		int bottomEnd = bottom.size() - 1;
+		while (topIndex < topEnd || bottomIndex < bottomEnd)
+		{
+			if (bottomIndex == bottomEnd || (topIndex < topEnd && top[topIndex + 1].position.x <= bottom[bottomIndex + 1].position.x))
+			{
+				CreateTriangle(top[topIndex], top[topIndex + 1], bottom[bottomIndex]);
+				topIndex++;
+			}
+			else
+			{
+				CreateTriangle(top[topIndex], bottom[bottomIndex + 1], bottom[bottomIndex]);
+				bottomIndex++;
+			}
+		}
+
+		for (unsigned int i = 0; i < top.size(); i++)
+		{
+			checkedVertices.insert(top[i].vertexIndex);
+		}
+		for (unsigned int i = 0; i < bottom.size(); i++)
+		{
+			checkedVertices.insert(bottom[i].vertexIndex);
+		}
+		for (unsigned int i = 0; i < left.size(); i++)
+		{
+			checkedVertices.insert(left[i].vertexIndex);
+		}
+		for (unsigned int i = 0; i < right.size(); i++)
+		{
+			checkedVertices.insert(right[i].vertexIndex);
+		}
+	} // Keeps the rectangle corners and any node along its edges that a neighbouring shape has a vertex on, so no T-junctions are left between them.
+	  // The left edge is fanned from the second bottom node, the right edge from the second to last top node, and the band left between them is stitched 
+	  // as a strip along the top and bottom edges. This gives the fewest triangles possible without any degenerate ones, two when the edges are clear.
 
 	void CreateWallMesh() 
 	{
-		CalculateMeshOutlines();
+		{
+			ScopedTimer timer("Outline extraction");
+			CalculateMeshOutlines();
+		}
+		if (simplifyOutlines)
+		{
+			ScopedTimer timer("Outline simplification");
+			SimplifyOutlines();
+		}
 
+		ScopedTimer timer("Wall extrusion");
 		wallVertices = std::vector<glm::vec3>();
 		wallTriangles = std::vector<int>();
-		float wallHeight = 5;
 
+		std::vector<std::vector<glm::vec3>> chunkSegments = std::vector<std::vector<glm::vec3>>(chunks.size());
 		for (unsigned int j = 0; j < outlines.size(); j++) 
 		{
 			for (int i = 0; i < outlines[j].size() - 1; i++) 
 			{
-				int startIndex = wallVertices.size();
-				wallVertices.push_back(vertices[outlines[j][i]]); // left
-				wallVertices.push_back(vertices[outlines[j][i + 1]]); // right
-				wallVertices.push_back(vertices[outlines[j][i]] - glm::vec3(0.0f, 1.0f, 0.0f) * wallHeight); // bottom left
-				wallVertices.push_back(vertices[outlines[j][i + 1]] - glm::vec3(0.0f, 1.0f, 0.0f) * wallHeight); // bottom right
-
-				wallTriangles.push_back(startIndex + 0);
-				wallTriangles.push_back(startIndex + 2);
-				wallTriangles.push_back(startIndex + 3);
-
-				wallTriangles.push_back(startIndex + 3);
-				wallTriangles.push_back(startIndex + 1);
-				wallTriangles.push_back(startIndex + 0);
-			}
-		}
-	} // Creates the vertices vector and triangle vectors that are needed to create the final vectors that opengl needs.
-
-	void TriangulateSquare(Square square) 
-	{
-		switch (square.configuration)
-		{
-		case 0:
-			break;
-
-			// 1 points:
-		case 1:
-			MeshFromPoints(std::vector<Node>() = { square.centerLeft, square.centerBottom, square.bottomLeft });
-			break;
-		case 2:
-			MeshFromPoints(std::vector<Node>() = { square.bottomRight, square.centerBottom, square.centerRight });
-			break;
-		case 4:
-			MeshFromPoints(std::vector<Node>() = { square.topRight, square.centerRight, square.centerTop });
-			break;
-		case 8:
-			MeshFromPoints(std::vector<Node>() = { square.topLeft, square.centerTop, square.centerLeft });
-			break;
-
-			// 2 points:
-		case 3:
-			MeshFromPoints(std::vector<Node>() = { square.centerRight, square.bottomRight, square.bottomLeft, square.centerLeft });
-			break;
-		case 6:
-			MeshFromPoints(std::vector<Node>() = { square.centerTop, square.topRight, square.bottomRight, square.centerBottom });
-			break;
-		case 9:
-			MeshFromPoints(std::vector<Node>() = { square.topLeft, square.centerTop, square.centerBottom, square.bottomLeft });
-			break;
-		case 12:
-			MeshFromPoints(std::vector<Node>() = { square.topLeft, square.topRight, square.centerRight, square.centerLeft });
-			break;
-		case 5:
-			MeshFromPoints(std::vector<Node>() = { square.centerTop, square.topRight, square.centerRight, square.centerBottom, square.bottomLeft, square.centerLeft });
-			break;
-		case 10:
-			MeshFromPoints(std::vector<Node>() = { square.topLeft, square.centerTop, square.centerRight, square.bottomRight, square.centerBottom, square.centerLeft });
-			break;
-
-			// 3 point:
-		case 7:
-			MeshFromPoints(std::vector<Node>() = { square.centerTop, square.topRight, square.bottomRight, square.bottomLeft, square.centerLeft });
-			break;
-		case 11:
-			MeshFromPoints(std::vector<Node>() = { square.topLeft, square.centerTop, square.centerRight, square.bottomRight, square.bottomLeft });
-			break;
-		case 13:
-			MeshFromPoints(std::vector<Node>() = { square.topLeft, square.topRight, square.centerRight, square.centerBottom, square.bottomLeft });
-			break;
-		case 14:
-			MeshFromPoints(std::vector<Node>() = { square.topLeft, square.topRight, square.bottomRight, square.centerBottom, square.centerLeft });
-			break;
-
-			// 4 point:
-		case 15:
-			MeshFromPoints(std::vector<Node>() = { square.topLeft, square.topRight, square.bottomRight, square.bottomLeft });
-			checkedVertices.insert(square.topLeft.vertexIndex);
-			checkedVertices.insert(square.topRight.vertexIndex);
-			checkedVertices.insert(square.bottomRight.vertexIndex);
-			checkedVertices.insert(square.bottomLeft.vertexIndex);
-			break; // I can insert all these squares vertex index into the set as I know this configuration doesn't have any walls at any side. 
-		}
-	} // Takes a square and depending on its configuration it will send the appropriate points to the next function. 
-
-	void MeshFromPoints(std::vector<Node>& points)
-	{
-		AssignVertices(points);
-
-		if (points.size() >= 3)
-		{
-			CreateTriangle(points[0], points[1], points[2]);
-		}
-		if (points.size() >= 4)
-		{
-			CreateTriangle(points[0], points[2], points[3]);
-		}
-		if (points.size() >= 5)
-		{
-			CreateTriangle(points[0], points[3], points[4]);
-		}
-		if (points.size() >= 6)
-		{
-			CreateTriangle(points[0], points[4], points[5]);
-		}
-	} // Creates triangles and add the triangle to the map as appropriate. 
+				glm::vec3 left = vertices[outlines[j][i]];
+				glm::vec3 right = vertices[outlines[j][i + 1]];
+				std::vector<glm::vec3>& segments = chunkSegments[GetChunkIndex((left + right) / 2.0f)];
+				segments.push_back(left);
+				segments.push_back(right);
+			}
+		}
+
+		if (chunkSkirts)
+		{
+			CreateChunkSkirts(chunkSegments);
+		}
+
+		size_t segmentCount = 0;
+		for (unsigned int j = 0; j < chunkSegments.size(); j++)
+		{
+			segmentCount += chunkSegments[j].size() / 2;
+		}
+		wallVertices.reserve(segmentCount * 4);
+		wallTriangles.reserve(segmentCount * 6);
+
+		for (unsigned int j = 0; j < chunks.size(); j++)
+		{
+			chunks[j].firstWallTriangle = wallTriangles.size() / 3;
+			for (unsigned int i = 0; i < chunkSegments[j].size(); i += 2)
+			{
+				CreateWallQuad(chunkSegments[j][i], chunkSegments[j][i + 1]);
+			}
+			chunks[j].wallTriangleCount = wallTriangles.size() / 3 - chunks[j].firstWallTriangle;
+		}
+	} // Creates the vertices vector and triangle vectors that are needed to create the final vectors that opengl needs. Each outline segment is given to the chunk 
+	  // its middle falls in, so a chunk's walls are stored together just like its floor.
+
+	void CreateWallQuad(glm::vec3 left, glm::vec3 right)
+	{
+		int startIndex = wallVertices.size();
+		wallVertices.push_back(left); // left
+		wallVertices.push_back(right); // right
+		wallVertices.push_back(left - glm::vec3(0.0f, 1.0f, 0.0f) * wallHeight); // bottom left
+		wallVertices.push_back(right - glm::vec3(0.0f, 1.0f, 0.0f) * wallHeight); // bottom right
+
+		wallTriangles.push_back(startIndex + 0);
+		wallTriangles.push_back(startIndex + 2);
+		wallTriangles.push_back(startIndex + 3);
+
+		wallTriangles.push_back(startIndex + 3);
+		wallTriangles.push_back(startIndex + 1);
+		wallTriangles.push_back(startIndex + 0);
+	} // Extrudes one segment down into a wall made of two triangles.
+
+	void CreateChunkSkirts(std::vector<std::vector<glm::vec3>>& chunkSegments)
+	{
+		for (int chunkX = 0; chunkX < chunkCountX; chunkX++)
+		{
+			for (int chunkY = 0; chunkY < chunkCountY; chunkY++)
+			{
+				glm::ivec4 area = GetChunkArea(chunkX, chunkY);
+				std::vector<glm::vec3>& segments = chunkSegments[chunkX * chunkCountY + chunkY];
+
+				for (int y = area.y; y < area.w; y++)
+				{
+					if (area.x > 0)
+					{
+						Square square = squareGrid.GetSquare(area.x, y);
+						AddSkirtSegment(square.bottomLeft, square.centerLeft, square.topLeft, segments);
+					}
+					if (area.z < GetSquareCountX())
+					{
+						Square square = squareGrid.GetSquare(area.z - 1, y);
+						AddSkirtSegment(square.bottomRight, square.centerRight, square.topRight, segments);
+					}
+				}
+				for (int x = area.x; x < area.z; x++)
+				{
+					if (area.y > 0)
+					{
+						Square square = squareGrid.GetSquare(x, area.y);
+						AddSkirtSegment(square.bottomLeft, square.centerBottom, square.bottomRight, segments);
+					}
+					if (area.w < GetSquareCountY())
+					{
+						Square square = squareGrid.GetSquare(x, area.w - 1);
+						AddSkirtSegment(square.topLeft, square.centerTop, square.topRight, segments);
+					}
+				}
+			}
+		}
+	} // Adds a skirt along every inner edge of each chunk. Where two neighbouring chunks are drawn at different levels of detail their edges no longer 
+	  // match, the skirt fills what would otherwise be a hole through the cave with wall. Only the squares along the chunk edges are built.
+
+	void AddSkirtSegment(ControlNode& start, Node& middle, ControlNode& end, std::vector<glm::vec3>& segments)
+	{
+		if (start.active && end.active)
+		{
+			segments.push_back(start.position);
+			segments.push_back(end.position);
+		}
+		else if (start.active)
+		{
+			segments.push_back(start.position);
+			segments.push_back(middle.position);
+		}
+		else if (end.active)
+		{
+			segments.push_back(middle.position);
+			segments.push_back(end.position);
+		}
+	} // Covers the part of a square's side that its floor reaches.
+
+	void SimplifyOutlines()
+	{
+		for (unsigned int i = 0; i < outlines.size(); i++)
+		{
+			std::vector<int> simplified = MergeCollinearVertices(outlines[i]);
+			if (outlineTolerance > 0.0f)
+			{
+				std::vector<int> decimated = DecimateOutline(simplified);
+				if (decimated.size() > 3)
+				{
+					simplified = decimated;
+				}
+			}
+			outlines[i] = simplified;
+		}
+	} // Simplifies every outline, first removing vertices on straight runs and then, if a tolerance is set, running Douglas-Peucker over what is left.
+	  // A decimated outline is only used if it still encloses an area, very small loops keep their collinear merged shape.
+
+	std::vector<int> MergeCollinearVertices(std::vector<int>& outline)
+	{
+		int count = outline.size() - 1; // Outlines end with their first vertex again.
+		if (count < 3)
+		{
+			return outline;
+		}
+
+		int start = -1;
+		for (int i = 0; i < count && start == -1; i++)
+		{
+			if (!IsCollinear(outline[(i + count - 1) % count], outline[i], outline[(i + 1) % count]))
+			{
+				start = i;
+			}
+		}
+		if (start == -1)
+		{
+			return outline;
+		}
+
+		std::vector<int> merged = std::vector<int>();
+		merged.push_back(outline[start]);
+		for (int i = 1; i < count; i++)
+		{
+			int current = outline[(start + i) % count];
+			int next = outline[(start + i + 1) % count];
+			if (!IsCollinear(merged[merged.size() - 1], current, next))
+			{
+				merged.push_back(current);
+			}
+		}
+		merged.push_back(outline[start]);
+
+		return merged;
+	} // Starts from a corner of the outline and only keeps vertices where the outline changes direction, the result is closed the same way as the input.
+
+	std::vector<int> DecimateOutline(std::vector<int>& outline)
+	{
+		int last = outline.size() - 1;
+		if (last < 3)
+		{
+			return outline;
+		}
+
+		int farthest = 1;
+		float farthestDistance = 0.0f;
+		for (int i = 1; i < last; i++)
+		{
+			float distance = glm::length(vertices[outline[i]] - vertices[outline[0]]);
+			if (distance > farthestDistance)
+			{
+				farthest = i;
+				farthestDistance = distance;
+			}
+		}
+
+		std::vector<bool> keep = std::vector<bool>(outline.size(), false);
+		keep[0] = true;
+		keep[farthest] = true;
+		keep[last] = true;
+
+		std::vector<glm::ivec2> spans = std::vector<glm::ivec2>() = { glm::ivec2(0, farthest), glm::ivec2(farthest, last) };
+		while (!spans.empty())
+		{
+			glm::ivec2 span = spans[spans.size() - 1];
+			spans.pop_back();
+
+			int worst = -1;
+			float worstDistance = outlineTolerance;
+			for (int i = span.x + 1; i < span.y; i++)
+			{
+				float distance = DistanceToSegment(outline[i], outline[span.x], outline[span.y]);
+				if (distance > worstDistance)
+				{
+					worst = i;
+					worstDistance = distance;
+				}
+			}
+
+			if (worst != -1)
+			{
+				keep[worst] = true;
+				spans.push_back(glm::ivec2(span.x, worst));
+				spans.push_back(glm::ivec2(worst, span.y));
+			}
+		}
+
+		std::vector<int> decimated = std::vector<int>();
+		for (unsigned int i = 0; i < outline.size(); i++)
+		{
+			if (keep[i])
+			{
+				decimated.push_back(outline[i]);
+			}
+		}
+		return decimated;
+	} // Douglas-Peucker over a closed outline. The loop is split at the vertex farthest from the start, then each span keeps its worst vertex 
+	  // while that vertex is further than the tolerance from the span. Spans are kept on a stack rather than recursed into so long outlines are safe.
+
+	bool IsCollinear(int vertexA, int vertexB, int vertexC)
+	{
+		glm::vec3 ab = vertices[vertexB] - vertices[vertexA];
+		glm::vec3 bc = vertices[vertexC] - vertices[vertexB];
+		float cross = ab.x * bc.z - ab.z * bc.x;
+		float dot = ab.x * bc.x + ab.z * bc.z;
+		return std::abs(cross) <= 0.0001f * glm::length(ab) * glm::length(bc) && dot > 0.0f;
+	} // Whether vertex B lies on the straight line from A to C, heading the same way. Outlines are flat so only x and z are compared.
+
+	float DistanceToSegment(int vertex, int segmentStart, int segmentEnd)
+	{
+		glm::vec3 point = vertices[vertex] - vertices[segmentStart];
+		glm::vec3 segment = vertices[segmentEnd] - vertices[segmentStart];
+		float lengthSquared = glm::dot(segment, segment);
+		if (lengthSquared == 0.0f)
+		{
+			return glm::length(point);
+		}
+		float t = glm::clamp(glm::dot(point, segment) / lengthSquared, 0.0f, 1.0f);
+		return glm::length(point - segment * t);
+	} // Distance from a vertex to the closest point on the segment between two others.
+
+	void TriangulateSquare(int x, int y) 
+	{
+		enum { topLeft, topRight, bottomRight, bottomLeft, centerTop, centerRight, centerBottom, centerLeft };
+		static const int pointNodes[8][3] = { { 0, 1, 0 }, { 1, 1, 0 }, { 1, 0, 0 }, { 0, 0, 0 }, { 0, 1, 2 }, { 1, 0, 1 }, { 0, 0, 2 }, { 0, 0, 1 } };
+		static const int casePointCounts[16] = { 0, 3, 3, 4, 3, 6, 4, 5, 3, 4, 6, 5, 4, 5, 5, 0 };
+		static const int casePoints[16][6] =
+		{
+			{ 0 },
+			{ centerLeft, centerBottom, bottomLeft },
+			{ bottomRight, centerBottom, centerRight },
+			{ centerRight, bottomRight, bottomLeft, centerLeft },
+			{ topRight, centerRight, centerTop },
+			{ centerTop, topRight, centerRight, centerBottom, bottomLeft, centerLeft },
+			{ centerTop, topRight, bottomRight, centerBottom },
+			{ centerTop, topRight, bottomRight, bottomLeft, centerLeft },
+			{ topLeft, centerTop, centerLeft },
+			{ topLeft, centerTop, centerBottom, bottomLeft },
+			{ topLeft, centerTop, centerRight, bottomRight, centerBottom, centerLeft },
+			{ topLeft, centerTop, centerRight, bottomRight, bottomLeft },
+			{ topLeft, topRight, centerRight, centerLeft },
+			{ topLeft, topRight, centerRight, centerBottom, bottomLeft },
+			{ topLeft, topRight, bottomRight, centerBottom, centerLeft },
+			{ 0 }
+		};
+
+		int configuration = GetConfiguration(x, y);
+		if (configuration == 15)
+		{
+			TriangulateSolidSquares(x, y, y + 1);
+			return;
+		}
+
+		int firstNewVertex = vertices.size();
+		int points[6];
+		for (int i = 0; i < casePointCounts[configuration]; i++)
+		{
+			const int* node = pointNodes[casePoints[configuration][i]];
+			points[i] = GetNodeVertex(x + node[0], y + node[1], node[2]);
+		}
+		for (int i = 2; i < casePointCounts[configuration]; i++)
+		{
+			CreateTriangle(points[0], points[i - 1], points[i]);
+		}
+
+		for (int vertexIndex = firstNewVertex; vertexIndex < int(vertices.size()); vertexIndex++)
+		{
+			outlineCandidates.push_back(vertexIndex);
+		}
+	} // Meshes the square at a grid position from its packed configuration. Each case is a list of the square's eight points going round its shape, and each
+	  // point is a control node, the node above one or the node to the right of one, at an offset from the square's bottom left. The shape is fanned from its
+	  // first point. No square or node is built, the vertices come straight from their grid positions and the ones made here are kept as outline candidates.
+	  // A fully active square is meshed by TriangulateSolidSquares, which marks its corners as checked.
 
 	void AssignVertices(std::vector<Node>& points)
 	{
 		for (int i = 0; i < points.size(); i++) 
 		{
+			if (points[i].vertexIndex == -1 && points[i].nodeIndex != -1)
+			{
+				points[i].vertexIndex = nodeVertexIndices[points[i].nodeIndex];
+			}
 			if (points[i].vertexIndex == -1) 
 			{
 				points[i].vertexIndex = vertices.size();
 				vertices.push_back(points[i].position);
+				if (points[i].nodeIndex != -1)
+				{
+					nodeVertexIndices[points[i].nodeIndex] = points[i].vertexIndex;
+				}
 			}
 		}
 	} // Updates the vertexIndex with the neew size of the vertices array, this will be useful later when I need to correlate between these indices and the actual vector3s. Also pushes
-	  // the position of the node to the vertices array. 
+	  // the position of the node to the vertices array. Nodes that already have a vertex from a neighbouring square reuse it.
 
 	void CreateTriangle(Node a, Node b, Node c) 
 	{
-		triangles.push_back(a.vertexIndex);
-		triangles.push_back(b.vertexIndex);
-		triangles.push_back(c.vertexIndex);
+		CreateTriangle(a.vertexIndex, b.vertexIndex, c.vertexIndex);
+	}
 
-		Triangle triangle(a.vertexIndex, b.vertexIndex, c.vertexIndex);
+	void CreateTriangle(int vertexA, int vertexB, int vertexC) 
+	{
+		triangles.push_back(vertexA);
+		triangles.push_back(vertexB);
+		triangles.push_back(vertexC);
+
+		Triangle triangle(vertexA, vertexB, vertexC);
 		AddTriangleToDictionary(triangle.vertexIndexA, triangle);
 		AddTriangleToDictionary(triangle.vertexIndexB, triangle);
 		AddTriangleToDictionary(triangle.vertexIndexC, triangle);
@@ -409,8 +1271,9 @@ public:
 
 	void CalculateMeshOutlines()
 	{
-		for (int vertexIndex = 0; vertexIndex < vertices.size(); vertexIndex++) 
+		for (unsigned int i = 0; i < outlineCandidates.size(); i++) 
 		{
+			int vertexIndex = outlineCandidates[i];
 			if (checkedVertices.find(vertexIndex) == checkedVertices.end())
 			{
 				int newOutlineVertex = GetConnectedOutlineVertex(vertexIndex);
@@ -425,20 +1288,20 @@ public:
 				}
 			}
 		}
-	} // Runs through every vertex in the map and checks if an element is an outline vertex. If it is then it follows the outline 
-	  // all the way around until it meets up with itself, then it adds itself to the outline list.
+	} // Runs through the outline candidates, which only come from mixed blocks, and checks if each is an outline vertex. If it is then it follows the outline
+	  // all the way around until it meets up with itself, then it adds itself to the outline list. The candidates are in the order their vertices were made,
+	  // so outlines start from the same vertices as they would walking every vertex.
 
-	void FollowOutline(int& vertexIndex, int outlineIndex) 
+	void FollowOutline(int vertexIndex, int outlineIndex) 
 	{
-		outlines[outlineIndex].push_back(vertexIndex);
-		checkedVertices.insert(vertexIndex);
-		int nextVertexIndex = GetConnectedOutlineVertex(vertexIndex);
-
-		if (nextVertexIndex != -1) 
+		while (vertexIndex != -1)
 		{
-			FollowOutline(nextVertexIndex, outlineIndex);
+			outlines[outlineIndex].push_back(vertexIndex);
+			checkedVertices.insert(vertexIndex);
+			vertexIndex = GetConnectedOutlineVertex(vertexIndex);
 		}
-	} // Follows the outline until there is no more vertices left. Adds each index to the outline vector as it goes. 
+	} // Follows the outline until there is no more vertices left. Adds each index to the outline vector as it goes. A loop rather than recursion, a whole
+	  // contour of a large cave can run to tens of thousands of vertices.
 
 	int GetConnectedOutlineVertex(int& vertexIndex) 
 	{
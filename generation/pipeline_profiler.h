@@ -0,0 +1,141 @@
+#ifndef PIPELINE_PROFILER_CLASS
+#define PIPELINE_PROFILER_CLASS
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+
+struct ProfileSample
+{
+	std::string name;
+	double startMicroseconds;
+	double durationMicroseconds;
+};
+
+struct ProfileCount
+{
+	std::string name;
+	size_t value;
+};
+
+class PipelineProfiler
+{
+public:
+	std::vector<ProfileSample> samples;
+	std::vector<ProfileCount> counts;
+	std::chrono::steady_clock::time_point epoch;
+
+	PipelineProfiler()
+	{
+		PipelineProfiler::samples = std::vector<ProfileSample>();
+		PipelineProfiler::counts = std::vector<ProfileCount>();
+		PipelineProfiler::epoch = std::chrono::steady_clock::now();
+	}
+
+	static PipelineProfiler& Get()
+	{
+		static PipelineProfiler profiler;
+		return profiler;
+	} // The one profiler every stage of the pipeline reports to.
+
+	void Clear()
+	{
+		samples.clear();
+		counts.clear();
+		epoch = std::chrono::steady_clock::now();
+	} // Forgets the last run, called before a new cave is generated.
+
+	void AddSample(const char* name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+	{
+		ProfileSample sample;
+		sample.name = name;
+		sample.startMicroseconds = std::chrono::duration<double, std::micro>(start - epoch).count();
+		sample.durationMicroseconds = std::chrono::duration<double, std::micro>(end - start).count();
+		samples.push_back(sample);
+	}
+
+	void AddCount(const char* name, size_t value)
+	{
+		for (unsigned int i = 0; i < counts.size(); i++)
+		{
+			if (counts[i].name == name)
+			{
+				counts[i].value += value;
+				return;
+			}
+		}
+		ProfileCount count;
+		count.name = name;
+		count.value = value;
+		counts.push_back(count);
+	} // Counts with the same name are added together, so levels of detail report their total.
+
+	double GetTotalMilliseconds()
+	{
+		double total = 0.0;
+		for (unsigned int i = 0; i < samples.size(); i++)
+		{
+			total += samples[i].durationMicroseconds;
+		}
+		return total / 1000.0;
+	}
+
+	bool ExportChromeTrace(const std::string& filePath)
+	{
+		std::ofstream file(filePath);
+		if (!file.is_open())
+		{
+			return false;
+		}
+
+		double endMicroseconds = 0.0;
+		file << "{\"traceEvents\":[";
+		for (unsigned int i = 0; i < samples.size(); i++)
+		{
+			file << (i == 0 ? "" : ",") << "\n{\"name\":\"" << samples[i].name << "\",\"cat\":\"generation\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":"
+				<< samples[i].startMicroseconds << ",\"dur\":" << samples[i].durationMicroseconds << "}";
+			endMicroseconds = std::max(endMicroseconds, samples[i].startMicroseconds + samples[i].durationMicroseconds);
+		}
+		for (unsigned int i = 0; i < counts.size(); i++)
+		{
+			file << (samples.empty() && i == 0 ? "" : ",") << "\n{\"name\":\"" << counts[i].name << "\",\"cat\":\"generation\",\"ph\":\"C\",\"pid\":1,\"ts\":"
+				<< endMicroseconds << ",\"args\":{\"value\":" << counts[i].value << "}}";
+		}
+		file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+		return file.good();
+	} // Writes every sample as a complete event and every count as a counter event, in the Chrome trace format that chrome://tracing and Perfetto open.
+}; // Collects how long each stage of generating a cave took along with the size of what it produced.
+
+class ScopedTimer
+{
+public:
+	const char* name;
+	std::chrono::steady_clock::time_point start;
+	bool stopped;
+
+	ScopedTimer(const char* name)
+	{
+		ScopedTimer::name = name;
+		ScopedTimer::start = std::chrono::steady_clock::now();
+		ScopedTimer::stopped = false;
+	}
+
+	~ScopedTimer()
+	{
+		Stop();
+	}
+
+	void Stop()
+	{
+		if (!stopped)
+		{
+			PipelineProfiler::Get().AddSample(name, start, std::chrono::steady_clock::now());
+			stopped = true;
+		}
+	} // Reports early, for stages whose results have to outlive the scope being timed.
+}; // Times the scope it is declared in and reports it to the profiler when the scope ends.
+
+#endif
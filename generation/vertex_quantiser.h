@@ -0,0 +1,117 @@
+#ifndef VERTEX_QUANTISER_CLASS
+#define VERTEX_QUANTISER_CLASS
+
+#include <cstdint>
+#include <cmath>
+#include <vector>
+
+#include "pipeline_profiler.h"
+
+// Packs the vertex buffers from MeshGenerator::CreateFinalVertexBuffers into 16 bit integers. Every vertex of a cave sits on a lattice of half a square, the
+// corners and edge midpoints of the marching squares, and wall vertices are only ever at the top or bottom of the wall, so positions are stored as whole numbers
+// of lattice steps and the shaders multiply them back out.
+//
+//   floor vertex    x, z                  the floor is flat at y = 0 and its colour is the same everywhere, so it becomes a uniform
+//   wall vertex     x, y, z, padding      the texture coordinates repeat every triangle, so the shader picks them from gl_VertexID
+//
+// A floor vertex is 4 bytes rather than 24 and a wall vertex 8 rather than 20.
+
+class VertexQuantiser
+{
+public:
+	static const int floorVertexShorts = 2;
+	static const int wallVertexShorts = 4;
+
+	float latticeSpacing;
+	float floorColour[3];
+	std::vector<int16_t> verticesFloor;
+	std::vector<int16_t> verticesWalls;
+
+	VertexQuantiser(float latticeSpacing)
+	{
+		VertexQuantiser::latticeSpacing = latticeSpacing;
+		VertexQuantiser::floorColour[0] = 0.0f;
+		VertexQuantiser::floorColour[1] = 0.0f;
+		VertexQuantiser::floorColour[2] = 0.0f;
+		VertexQuantiser::verticesFloor = std::vector<int16_t>();
+		VertexQuantiser::verticesWalls = std::vector<int16_t>();
+	} // The spacing is half the square size the mesh was generated with.
+
+	bool Quantise(const float* floor, size_t floorFloatCount, const float* walls, size_t wallFloatCount)
+	{
+		ScopedTimer timer("Quantise vertices");
+		static const float wallUVs[] = { 1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f };
+
+		verticesFloor.clear();
+		verticesWalls.clear();
+		verticesFloor.reserve(floorFloatCount / 6 * floorVertexShorts);
+		verticesWalls.reserve(wallFloatCount / 5 * wallVertexShorts);
+
+		for (size_t i = 0; i < floorFloatCount; i += 6)
+		{
+			if (i == 0)
+			{
+				floorColour[0] = floor[3];
+				floorColour[1] = floor[4];
+				floorColour[2] = floor[5];
+			}
+			int16_t x;
+			int16_t z;
+			if (floor[i + 1] != 0.0f || floor[i + 3] != floorColour[0] || floor[i + 4] != floorColour[1] || floor[i + 5] != floorColour[2]
+				|| !ToLattice(floor[i], x) || !ToLattice(floor[i + 2], z))
+			{
+				return Fail();
+			}
+			verticesFloor.push_back(x);
+			verticesFloor.push_back(z);
+		}
+
+		for (size_t i = 0, vertex = 0; i < wallFloatCount; i += 5, vertex++)
+		{
+			int16_t x;
+			int16_t y;
+			int16_t z;
+			if (walls[i + 3] != wallUVs[(vertex % 3) * 2] || walls[i + 4] != wallUVs[(vertex % 3) * 2 + 1]
+				|| !ToLattice(walls[i], x) || !ToLattice(walls[i + 1], y) || !ToLattice(walls[i + 2], z))
+			{
+				return Fail();
+			}
+			verticesWalls.push_back(x);
+			verticesWalls.push_back(y);
+			verticesWalls.push_back(z);
+			verticesWalls.push_back(0);
+		}
+
+		PipelineProfiler::Get().AddCount("Quantised bytes", (verticesFloor.size() + verticesWalls.size()) * sizeof(int16_t));
+		return true;
+	} // Returns false and leaves both buffers empty if any vertex is off the lattice, too far out for 16 bits, or has a colour or texture coordinates the shaders
+	  // would not reproduce. The float buffers should then be drawn as they are.
+
+	void Release()
+	{
+		std::vector<int16_t>().swap(verticesFloor);
+		std::vector<int16_t>().swap(verticesWalls);
+	} // Frees the quantised vertices once they have been uploaded.
+
+private:
+	bool ToLattice(float value, int16_t& steps)
+	{
+		float scaled = value / latticeSpacing;
+		float rounded = std::floor(scaled + 0.5f);
+		if (std::fabs(scaled - rounded) > 1e-3f || rounded < -32768.0f || rounded > 32767.0f)
+		{
+			return false;
+		}
+		steps = int16_t(rounded);
+		return true;
+	}
+
+	bool Fail()
+	{
+		verticesFloor.clear();
+		verticesWalls.clear();
+		return false;
+	}
+};
+
+#endif
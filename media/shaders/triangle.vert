@@ -4,10 +4,25 @@ layout (location = 1) in vec3 aColour;
 
 out vec3 ourColour;
 
-uniform mat4 fullTransformMatrix;
+layout (std140) uniform FrameUniforms
+{
+    mat4 viewProjection;
+};
+
+uniform mat4 model;
+uniform bool quantised;
+uniform float latticeSpacing;
+uniform vec3 floorColour;
 
 void main()
 {
-    gl_Position = fullTransformMatrix * (vec4(aPos, 1.0f));
+    vec3 position = aPos;
     ourColour = aColour;
+    if (quantised)
+    {
+        // Quantised floor vertices are an x and z in lattice steps, the floor is flat and one colour.
+        position = vec3(aPos.x, 0.0, aPos.y) * latticeSpacing;
+        ourColour = floorColour;
+    }
+    gl_Position = viewProjection * model * (vec4(position, 1.0f));
 }
\ No newline at end of file
@@ -4,10 +4,28 @@ layout (location = 1) in vec2 aTexCoord;
 
 out vec2 TexCoord;
 
-uniform mat4 fullTransformMatrix;
+layout (std140) uniform FrameUniforms
+{
+    mat4 viewProjection;
+};
+
+uniform mat4 model;
+uniform bool quantised;
+uniform float latticeSpacing;
+
+// Texture coordinates of the three vertices of every wall triangle.
+const vec2 wallTexCoords[3] = vec2[3](vec2(1.0, 1.0), vec2(1.0, 0.0), vec2(0.0, 1.0));
 
 void main()
 {
-    gl_Position = fullTransformMatrix * (vec4(aPos, 1.0f));
-    TexCoord = vec2(aTexCoord.x, 1.0 - aTexCoord.y);
+    vec3 position = aPos;
+    vec2 texCoord = aTexCoord;
+    if (quantised)
+    {
+        // Quantised wall vertices are in lattice steps and carry no texture coordinates, every third vertex starts a new triangle.
+        position = aPos * latticeSpacing;
+        texCoord = wallTexCoords[gl_VertexID % 3];
+    }
+    gl_Position = viewProjection * model * (vec4(position, 1.0f));
+    TexCoord = vec2(texCoord.x, 1.0 - texCoord.y);
 }
\ No newline at end of file
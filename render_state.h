@@ -0,0 +1,174 @@
+#ifndef RENDER_STATE_CLASS
+#define RENDER_STATE_CLASS
+
+#include <GL/glew.h>
+
+// Remembers the program, vertex array, textures and polygon mode last given to OpenGL and only makes the call when one of them actually changes. Shader,
+// VAO, Texture and FlatCave all go through it, so anything else that changes this state behind its back, such as the ImGui renderer, must be followed by
+// Invalidate. It also counts the calls made and skipped each frame for the Debug panel.
+
+struct RenderStateCounts
+{
+	unsigned int programChanges;
+	unsigned int vertexArrayBinds;
+	unsigned int textureBinds;
+	unsigned int polygonModeChanges;
+	unsigned int drawCalls;
+	unsigned int skippedCalls;
+
+	RenderStateCounts()
+	{
+		RenderStateCounts::programChanges = 0;
+		RenderStateCounts::vertexArrayBinds = 0;
+		RenderStateCounts::textureBinds = 0;
+		RenderStateCounts::polygonModeChanges = 0;
+		RenderStateCounts::drawCalls = 0;
+		RenderStateCounts::skippedCalls = 0;
+	}
+
+	unsigned int GetTotalCalls() const
+	{
+		return programChanges + vertexArrayBinds + textureBinds + polygonModeChanges + drawCalls;
+	}
+};
+
+class RenderState
+{
+public:
+	static const int textureUnitCount = 16;
+
+	RenderStateCounts counts; // Calls made since the frame began.
+	RenderStateCounts lastFrameCounts;
+
+	static RenderState& Get()
+	{
+		static RenderState renderState;
+		return renderState;
+	}
+
+	void BeginFrame()
+	{
+		lastFrameCounts = counts;
+		counts = RenderStateCounts();
+		Invalidate();
+	} // Called once at the top of every frame. ImGui draws with its own state at the end of the previous frame, so nothing that was bound can be relied on.
+
+	void Invalidate()
+	{
+		program = unknown;
+		vertexArray = unknown;
+		activeUnit = unknown;
+		for (int i = 0; i < textureUnitCount; i++)
+		{
+			textures[i] = unknown;
+		}
+		polygonMode = unknown;
+	} // Forgets everything, the next call for each piece of state goes through.
+
+	void UseProgram(GLuint id)
+	{
+		if (program == id)
+		{
+			counts.skippedCalls++;
+			return;
+		}
+		glUseProgram(id);
+		program = id;
+		counts.programChanges++;
+	}
+
+	void BindVertexArray(GLuint id)
+	{
+		if (vertexArray == id)
+		{
+			counts.skippedCalls++;
+			return;
+		}
+		glBindVertexArray(id);
+		vertexArray = id;
+		counts.vertexArrayBinds++;
+	}
+
+	void BindTexture(GLuint unit, GLuint id)
+	{
+		if (unit < GLuint(textureUnitCount) && textures[unit] == id)
+		{
+			counts.skippedCalls++;
+			return;
+		}
+		if (activeUnit != unit)
+		{
+			glActiveTexture(GL_TEXTURE0 + unit);
+			activeUnit = unit;
+		}
+		glBindTexture(GL_TEXTURE_2D, id);
+		if (unit < GLuint(textureUnitCount))
+		{
+			textures[unit] = id;
+		}
+		counts.textureBinds++;
+	} // Binds a 2D texture to a texture unit. Units past the tracked ones are always bound.
+
+	void DeleteVertexArray(GLuint id)
+	{
+		glDeleteVertexArrays(1, &id);
+		if (vertexArray == id)
+		{
+			vertexArray = 0;
+		}
+	} // Deleting the bound vertex array unbinds it, and its name may be handed out again.
+
+	void DeleteTexture(GLuint id)
+	{
+		glDeleteTextures(1, &id);
+		for (int i = 0; i < textureUnitCount; i++)
+		{
+			if (textures[i] == id)
+			{
+				textures[i] = 0;
+			}
+		}
+	} // Deleting a bound texture unbinds it from every unit.
+
+	void SetPolygonMode(GLenum mode)
+	{
+		if (polygonMode == mode)
+		{
+			counts.skippedCalls++;
+			return;
+		}
+		glPolygonMode(GL_FRONT_AND_BACK, mode);
+		polygonMode = mode;
+		counts.polygonModeChanges++;
+	}
+
+	void DrawArrays(GLenum mode, GLint first, GLsizei count)
+	{
+		glDrawArrays(mode, first, count);
+		counts.drawCalls++;
+	}
+
+	void MultiDrawArraysIndirect(GLenum mode, GLintptr offset, GLsizei drawCount)
+	{
+		glMultiDrawArraysIndirect(mode, (const void*)offset, drawCount, 0);
+		counts.drawCalls++;
+	} // Reads drawCount commands from the bound draw indirect buffer, starting offset bytes in. One call however many commands there are.
+
+private:
+	static const GLuint unknown = 0xFFFFFFFF; // Never a valid object name, so the first call after Invalidate always reaches OpenGL.
+
+	GLuint program;
+	GLuint vertexArray;
+	GLuint activeUnit;
+	GLuint textures[textureUnitCount];
+	GLenum polygonMode;
+
+	RenderState()
+	{
+		RenderState::counts = RenderStateCounts();
+		RenderState::lastFrameCounts = RenderStateCounts();
+		Invalidate();
+	}
+};
+
+#endif
\ No newline at end of file
@@ -4,7 +4,11 @@
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 
+#include "render_state.h"
+
 #include <string>
+#include <unordered_map>
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -14,6 +18,8 @@ class Shader
 public:
     unsigned int ID;
 
+    static const GLuint frameUniformsBinding = 0; // Binding point of the FrameUniforms block, see Project.cpp.
+
     Shader(const char* vertexPath, const char* fragmentPath)
     {
         std::string vertexCode;
@@ -56,74 +62,145 @@ public:
         CheckCompileErrors(ID, "PROGRAM");
         glDeleteShader(vertex);
         glDeleteShader(fragment);
-
+        CacheUniformLocations();
     }
 
     void Use() const
     {
-        glUseProgram(ID);
+        RenderState::Get().UseProgram(ID);
+    }
+
+    GLint GetUniformLocation(const std::string& name) const
+    {
+        std::unordered_map<std::string, GLint>::const_iterator location = uniformLocations.find(name);
+        return location == uniformLocations.end() ? -1 : location->second;
+    } // Looks the location up in the table filled at link time, -1 for a uniform the program does not use, which OpenGL ignores. Hold on to the location to
+      // set a uniform every frame without the lookup.
+
+    void BindUniformBlock(const char* blockName, GLuint bindingPoint) const
+    {
+        GLuint blockIndex = glGetUniformBlockIndex(ID, blockName);
+        if (blockIndex != GL_INVALID_INDEX)
+        {
+            glUniformBlockBinding(ID, blockIndex, bindingPoint);
+        }
+    } // Points the program's uniform block at the binding point a UBO is bound to.
+
+    void SetBool(GLint location, bool value) const
+    {
+        glUniform1i(location, (int)value);
+    }
+
+    void SetInt(GLint location, int value) const
+    {
+        glUniform1i(location, value);
+    }
+
+    void SetFloat(GLint location, float value) const
+    {
+        glUniform1f(location, value);
+    }
+
+    void SetVec3(GLint location, const glm::vec3& value) const
+    {
+        glUniform3fv(location, 1, &value[0]);
     }
 
+    void setMat4(GLint location, const glm::mat4& mat) const
+    {
+        glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]);
+    } // These take a location from GetUniformLocation, for uniforms that are set on every draw.
+
     void SetBool(const std::string& name, bool value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+        glUniform1i(GetUniformLocation(name), (int)value);
     }
 
     void SetInt(const std::string& name, int value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+        glUniform1i(GetUniformLocation(name), value);
     }
 
     void SetFloat(const std::string& name, float value) const
     {
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+        glUniform1f(GetUniformLocation(name), value);
     }
 
     void SetVec2(const std::string& name, const glm::vec2& value) const
     {
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform2fv(GetUniformLocation(name), 1, &value[0]);
     }
 
     void SetVec2(const std::string& name, float x, float y) const
     {
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+        glUniform2f(GetUniformLocation(name), x, y);
     }
 
     void SetVec3(const std::string& name, const glm::vec3& value) const
     {
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform3fv(GetUniformLocation(name), 1, &value[0]);
     }
 
     void SetVec3(const std::string& name, float x, float y, float z) const
     {
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+        glUniform3f(GetUniformLocation(name), x, y, z);
     }
 
     void SetVec4(const std::string& name, const glm::vec4& value) const
     {
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform4fv(GetUniformLocation(name), 1, &value[0]);
     }
     void SetVec4(const std::string& name, float x, float y, float z, float w) const
     {
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+        glUniform4f(GetUniformLocation(name), x, y, z, w);
     }
 
     void SetMat2(const std::string& name, const glm::mat2& mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix2fv(GetUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
 
     void SetMat3(const std::string& name, const glm::mat3& mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix3fv(GetUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
 
     void setMat4(const std::string& name, const glm::mat4& mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix4fv(GetUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
 
 private:
+    std::unordered_map<std::string, GLint> uniformLocations;
+
+    void CacheUniformLocations()
+    {
+        GLint uniformCount = 0;
+        GLint longestName = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &uniformCount);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &longestName);
+        std::string name = std::string(std::max(longestName, 1), '\0');
+        for (GLint i = 0; i < uniformCount; i++)
+        {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(ID, GLuint(i), GLsizei(name.size()), &length, &size, &type, &name[0]);
+            std::string uniformName = name.substr(0, length);
+            GLint location = glGetUniformLocation(ID, uniformName.c_str());
+            if (location < 0)
+            {
+                continue; // Members of uniform blocks have no location of their own.
+            }
+            uniformLocations[uniformName] = location;
+            if (uniformName.size() > 3 && uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0)
+            {
+                uniformLocations[uniformName.substr(0, uniformName.size() - 3)] = location;
+            }
+        }
+    } // Asks the linked program for every uniform it uses once, so setting a uniform never has to go through glGetUniformLocation. Arrays are listed as name[0]
+      // and can be set by either name.
+
     void CheckCompileErrors(GLuint shader, std::string type)
     {
         GLint success;
@@ -0,0 +1,144 @@
+#ifndef DRAW_LIST_CLASS
+#define DRAW_LIST_CLASS
+
+#include "flat_cave.h"
+#include "../shader.h"
+#include "../render_state.h"
+#include <glm/glm.hpp>
+#include <vector>
+#include <algorithm>
+#include <functional>
+
+struct DrawItem
+{
+	Shader* shader;
+	FlatCave* cave;
+	GLint modelLocation;
+	const glm::mat4* model;
+	GLint firstVertex;
+	GLsizei vertexCount;
+	DIB* commandBuffer; // Set for an indirect draw, which draws drawCount commands starting commandOffset bytes into the buffer instead of one range.
+	GLintptr commandOffset;
+	GLsizei drawCount;
+};
+
+class DrawList
+{
+public:
+	std::vector<DrawItem> items;
+
+	DrawList()
+	{
+		DrawList::items = std::vector<DrawItem>();
+	}
+
+	void Clear()
+	{
+		items.clear();
+	} // Keeps the memory, so a list that is filled every frame stops allocating after the first.
+
+	void Add(Shader& shader, GLint modelLocation, const glm::mat4& model, FlatCave& cave, GLint firstVertex, GLsizei vertexCount)
+	{
+		if (vertexCount <= 0)
+		{
+			return;
+		}
+		DrawItem item;
+		item.shader = &shader;
+		item.cave = &cave;
+		item.modelLocation = modelLocation;
+		item.model = &model;
+		item.firstVertex = firstVertex;
+		item.vertexCount = vertexCount;
+		item.commandBuffer = nullptr;
+		item.commandOffset = 0;
+		item.drawCount = 0;
+		items.push_back(item);
+	} // The model matrix is only pointed to, it must stay alive until Submit.
+
+	void AddIndirect(Shader& shader, GLint modelLocation, const glm::mat4& model, FlatCave& cave, DIB& commandBuffer, GLintptr commandOffset, GLsizei drawCount)
+	{
+		if (drawCount <= 0)
+		{
+			return;
+		}
+		DrawItem item;
+		item.shader = &shader;
+		item.cave = &cave;
+		item.modelLocation = modelLocation;
+		item.model = &model;
+		item.firstVertex = 0;
+		item.vertexCount = 0;
+		item.commandBuffer = &commandBuffer;
+		item.commandOffset = commandOffset;
+		item.drawCount = drawCount;
+		items.push_back(item);
+	}
+
+	void Submit()
+	{
+		std::stable_sort(items.begin(), items.end(), DrawOrder);
+
+		GLuint lastProgram = 0;
+		const glm::mat4* lastModel = nullptr;
+		for (unsigned int i = 0; i < items.size(); i++)
+		{
+			DrawItem item = items[i];
+			while (item.commandBuffer == nullptr && i + 1 < items.size() && items[i + 1].commandBuffer == nullptr && items[i + 1].shader == item.shader && items[i + 1].cave == item.cave && items[i + 1].model == item.model
+				&& items[i + 1].firstVertex == item.firstVertex + item.vertexCount)
+			{
+				item.vertexCount += items[++i].vertexCount;
+			}
+
+			if (item.shader->ID != lastProgram || item.model != lastModel)
+			{
+				item.shader->Use();
+				item.shader->setMat4(item.modelLocation, *item.model);
+				lastProgram = item.shader->ID;
+				lastModel = item.model;
+			}
+			if (item.commandBuffer != nullptr)
+			{
+				item.cave->DrawIndirect(*item.shader, *item.commandBuffer, item.commandOffset, item.drawCount);
+			}
+			else
+			{
+				item.cave->DrawRange(*item.shader, item.firstVertex, item.vertexCount);
+			}
+		}
+	} // Draws everything grouped by shader, texture, polygon mode and vertex array, so each only changes when it has to. Ranges of the same buffer that follow
+	  // on from each other, such as neighbouring chunks at the same level of detail, are joined into one draw call.
+
+private:
+	static GLuint GetTexture(const DrawItem& item)
+	{
+		return item.cave->textures.empty() ? 0 : item.cave->textures[0].ID;
+	}
+
+	static bool DrawOrder(const DrawItem& a, const DrawItem& b)
+	{
+		if (a.shader->ID != b.shader->ID)
+		{
+			return a.shader->ID < b.shader->ID;
+		}
+		if (GetTexture(a) != GetTexture(b))
+		{
+			return GetTexture(a) < GetTexture(b);
+		}
+		if (a.cave->wireFrame != b.cave->wireFrame)
+		{
+			return a.cave->wireFrame < b.cave->wireFrame;
+		}
+		if (a.cave->vertexArray.ID != b.cave->vertexArray.ID)
+		{
+			return a.cave->vertexArray.ID < b.cave->vertexArray.ID;
+		}
+		if (a.model != b.model)
+		{
+			return std::less<const glm::mat4*>()(a.model, b.model);
+		}
+		return a.firstVertex < b.firstVertex;
+	}
+};
+
+#endif
\ No newline at end of file
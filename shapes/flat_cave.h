@@ -3,82 +3,189 @@
 
 #include "../buffers/VAO.h"
 #include "../buffers/VBO.h"
+#include "../buffers/DIB.h"
 #include "../texture.h"
+#include "../texture_cache.h"
 #include "../shader.h"
 #include <vector>
+#include <algorithm>
 
 class FlatCave
 {
 public:
-	std::vector<std::vector<GLfloat>> vertices;
 	std::vector<Texture> textures;
 	VAO vertexArray;
+	VBO vertexBuffer;
+	GLsizeiptr bufferCapacity; // Bytes of storage behind the vertex buffer, it grows when a bigger cave is uploaded and is otherwise reused.
 	bool wireFrame;
 	GLsizeiptr stride;
+	GLsizei vertexCount;
+	bool quantised; // Vertices are 16 bit lattice positions decoded in the shader, see VertexQuantiser.
+	float latticeSpacing;
+	glm::vec3 colour;
 
-	FlatCave(std::vector<std::vector<GLfloat>>& vertices, bool wireFrame)
+	FlatCave(const GLfloat* vertices, size_t floatCount, bool wireFrame)
 	{
-		FlatCave::vertices = vertices;
 		FlatCave::textures = std::vector<Texture>();
-		FlatCave::vertexArray = VAO();
-		FlatCave::wireFrame = wireFrame;
-		FlatCave::stride = 6 * sizeof(GLfloat);
+		Reset(wireFrame);
+		Upload(vertices, floatCount);
+	} // Constructor takes interleaved position and colour vertices and creates the appropriate VBO and VAO objects. The vertices are only read during the upload,
+	  // so they can point straight into a memory mapped mesh file.
 
-		VBO vertexBuffer(vertices, (3 * stride));
+	FlatCave(const GLfloat* vertices, size_t floatCount, bool wireFrame, std::vector<Texture>& textures)
+	{
+		FlatCave::textures = textures;
+		Reset(wireFrame);
+		Upload(vertices, floatCount);
+	} // This version of the constructor takes interleaved position and texture coordinate vertices and a vector of textures for the textured part of the cave.
 
-		vertexArray.Bind();
+	FlatCave(const GLshort* vertices, size_t shortCount, float latticeSpacing, glm::vec3 colour, bool wireFrame)
+	{
+		FlatCave::textures = std::vector<Texture>();
+		Reset(wireFrame);
+		Upload(vertices, shortCount, latticeSpacing, colour);
+	} // Takes the quantised floor from VertexQuantiser, an x and z per vertex. The colour is the same for every vertex and is set as a uniform instead.
 
-		vertexArray.LinkAttrib(vertexBuffer, 0, 3, GL_FLOAT, stride, (void*)((3 * stride)));
-		vertexArray.LinkAttrib(vertexBuffer, 1, 3, GL_FLOAT, stride, (void*)(((3 * stride)) + (3 * sizeof(GLfloat))));
+	FlatCave(const GLshort* vertices, size_t shortCount, float latticeSpacing, bool wireFrame, std::vector<Texture>& textures)
+	{
+		FlatCave::textures = textures;
+		Reset(wireFrame);
+		Upload(vertices, shortCount, latticeSpacing, glm::vec3(0.0f, 0.0f, 0.0f));
+	} // Takes the quantised walls from VertexQuantiser, the shader works out the texture coordinates from each vertex's place in its triangle.
 
-		vertexArray.Unbind();
-		vertexBuffer.Unbind();
-	} // Constructor takes the vertices and created the appropriate VBO and VAO objects.
+	FlatCave(std::vector<GLfloat> vertices, bool wireFrame) : FlatCave(vertices.data(), vertices.size(), wireFrame)
+	{
+	} // Takes the vertices from MeshGenerator::CreateFinalVertexBuffers. Move them in and they are freed as soon as they are uploaded, the cave keeps no copy.
 
-	FlatCave(std::vector<std::vector<GLfloat>>& vertices, bool wireFrame, std::vector<Texture>& textures) 
+	FlatCave(std::vector<GLfloat> vertices, bool wireFrame, std::vector<Texture>& textures) : FlatCave(vertices.data(), vertices.size(), wireFrame, textures)
 	{
-		FlatCave::vertices = vertices;
-		FlatCave::textures = textures;
-		FlatCave::vertexArray = VAO();
-		FlatCave::wireFrame = wireFrame;
-		FlatCave::stride = 5 * sizeof(GLfloat);
+	}
 
-		VBO vertexBuffer(vertices, (3 * stride));
-		vertexArray = VAO();
+	void Upload(const GLfloat* vertices, size_t floatCount)
+	{
+		quantised = false;
+		latticeSpacing = 1.0f;
+		colour = glm::vec3(0.0f, 0.0f, 0.0f);
+		stride = (textures.empty() ? 6 : 5) * sizeof(GLfloat);
+		vertexCount = GLsizei(floatCount * sizeof(GLfloat) / stride);
+		WriteBuffer(vertices, floatCount * sizeof(GLfloat));
 
 		vertexArray.Bind();
+		vertexArray.LinkAttrib(vertexBuffer, 0, 3, GL_FLOAT, stride, (void*)0);
+		vertexArray.LinkAttrib(vertexBuffer, 1, textures.empty() ? 3 : 2, GL_FLOAT, stride, (void*)(3 * sizeof(GLfloat)));
+		vertexArray.Unbind();
+	} // Replaces the cave's vertices, reusing its buffers. A cave with textures takes wall vertices and one without takes floor vertices, as the constructors do.
 
-		vertexArray.LinkAttrib(vertexBuffer, 0, 3, GL_FLOAT, stride, (void*)((3 * stride)));
-		vertexArray.LinkAttrib(vertexBuffer, 1, 2, GL_FLOAT, stride, (void*)((3 * stride) + (3 * sizeof(GLfloat))));
+	void Upload(std::vector<GLfloat> vertices)
+	{
+		Upload(vertices.data(), vertices.size());
+	} // Like the constructor, moved in vertices are freed once they are on the GPU.
 
+	void Upload(const GLshort* vertices, size_t shortCount, float latticeSpacing, glm::vec3 colour)
+	{
+		quantised = true;
+		FlatCave::latticeSpacing = latticeSpacing;
+		FlatCave::colour = colour;
+		stride = (textures.empty() ? 2 : 4) * sizeof(GLshort);
+		vertexCount = GLsizei(shortCount * sizeof(GLshort) / stride);
+		WriteBuffer(vertices, shortCount * sizeof(GLshort));
+
+		vertexArray.Bind();
+		vertexArray.LinkAttrib(vertexBuffer, 0, textures.empty() ? 2 : 3, GL_SHORT, stride, (void*)0);
+		vertexArray.DisableAttrib(1);
 		vertexArray.Unbind();
-		vertexBuffer.Unbind();
-	} // This version of the constructor takes a vector of textures for the textured part of the cave. 
+	} // Replaces the cave's vertices with quantised ones. The colour is only used by a floor.
 
 	void Draw(Shader& shader)
 	{
+		DrawRange(shader, 0, vertexCount);
+	}
 
-		shader.Use();
-		vertexArray.Bind();
+	void DrawRange(Shader& shader, GLint firstVertex, GLsizei vertexCount)
+	{
+		Prepare(shader);
+		RenderState::Get().DrawArrays(GL_TRIANGLES, firstVertex, vertexCount);
+	} // Draws part of the cave, every three vertices are one triangle so a range of triangles starts at three times its first index. State that is already set
+	  // is skipped by RenderState, see DrawList for drawing many ranges in an order that makes the most of that.
+
+	void DrawIndirect(Shader& shader, DIB& commandBuffer, GLintptr offset, GLsizei drawCount)
+	{
+		Prepare(shader);
+		commandBuffer.Bind();
+		RenderState::Get().MultiDrawArraysIndirect(GL_TRIANGLES, offset, drawCount);
+		commandBuffer.Unbind();
+	} // Draws every range listed in the command buffer with one call. Needs OpenGL 4.3 or ARB_multi_draw_indirect.
+
+	void Delete() 
+	{
+		vertexArray.Delete();
+		vertexBuffer.Delete();
+		bufferCapacity = 0;
 		for (unsigned int i = 0; i < textures.size(); i++)
 		{
-			textures[i].Bind();
+			TextureCache::Get().Release(textures[i]);
 		}
-		if (wireFrame)
-		{
-			glPolygonMode(GL_FRONT_AND_BACK, GL_LINE); // Wireframe mode
-		}
-		else
+		textures.clear();
+	} // The cave holds on to the textures it was given until it is deleted, so they should come from TextureCache::Acquire.
+
+private:
+	// Uniform locations in the shader the cave was last drawn with, looked up again only when it is drawn with a different one.
+	GLuint locationShader;
+	GLint quantisedLocation;
+	GLint latticeSpacingLocation;
+	GLint colourLocation;
+
+	void Reset(bool wireFrame)
+	{
+		FlatCave::bufferCapacity = 0;
+		FlatCave::wireFrame = wireFrame;
+		FlatCave::stride = 0;
+		FlatCave::vertexCount = 0;
+		FlatCave::quantised = false;
+		FlatCave::latticeSpacing = 1.0f;
+		FlatCave::colour = glm::vec3(0.0f, 0.0f, 0.0f);
+		FlatCave::locationShader = 0;
+		FlatCave::quantisedLocation = -1;
+		FlatCave::latticeSpacingLocation = -1;
+		FlatCave::colourLocation = -1;
+	}
+
+	void WriteBuffer(const void* data, GLsizeiptr size)
+	{
+		vertexBuffer.Bind();
+		if (size > bufferCapacity)
 		{
-			glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+			bufferCapacity = std::max(size, bufferCapacity + bufferCapacity / 2);
 		}
-		glDrawArrays(GL_TRIANGLES, 0, vertices.size() * stride);	
-	}
+		glBufferData(GL_ARRAY_BUFFER, bufferCapacity, NULL, GL_DYNAMIC_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, size, data);
+		vertexBuffer.Unbind();
+	} // Orphans the old storage, so the driver can hand the same memory back once the GPU has finished with it rather than stalling, and grows it by half again
+	  // when the new vertices do not fit so a run of slightly bigger caves does not reallocate every time. The buffer never shrinks.
 
-	void Delete() 
+	void Prepare(Shader& shader)
 	{
-		vertexArray.Delete();
-	}
+		shader.Use();
+		if (shader.ID != locationShader)
+		{
+			locationShader = shader.ID;
+			quantisedLocation = shader.GetUniformLocation("quantised");
+			latticeSpacingLocation = shader.GetUniformLocation("latticeSpacing");
+			colourLocation = shader.GetUniformLocation("floorColour");
+		}
+		shader.SetBool(quantisedLocation, quantised);
+		if (quantised)
+		{
+			shader.SetFloat(latticeSpacingLocation, latticeSpacing);
+			shader.SetVec3(colourLocation, colour);
+		}
+		vertexArray.Bind();
+		for (unsigned int i = 0; i < textures.size(); i++)
+		{
+			textures[i].Bind();
+		}
+		RenderState::Get().SetPolygonMode(wireFrame ? GL_LINE : GL_FILL);
+	} // Sets up everything a draw of this cave needs.
 };
 
 #endif
\ No newline at end of file
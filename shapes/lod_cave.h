@@ -0,0 +1,244 @@
+#ifndef LOD_CAVE_CLASS
+#define LOD_CAVE_CLASS
+
+#include "flat_cave.h"
+#include "draw_list.h"
+#include "../buffers/DIB.h"
+#include "../generation/mesh_chunk.h"
+#include <vector>
+#include <algorithm>
+
+class LodCave
+{
+public:
+	// Every level of detail packed one after another into a single buffer, so a frame's chunks can be drawn with one call whatever level each is at. Each
+	// holds one cave once Build has been called.
+	std::vector<FlatCave> walls;
+	std::vector<FlatCave> ceilings; // Drawn again as the floor with a lower transform.
+	std::vector<std::vector<MeshChunk>> chunks; // One entry per level of detail, starting at full resolution.
+	std::vector<GLint> levelFirstWallVertex; // Where each level starts in the packed buffers.
+	std::vector<GLint> levelFirstVertex;
+
+	std::vector<int> chunkLevels; // Level each chunk was last drawn at, -1 if it was outside the view.
+	float lodDistance; // Distance covered by each level before the next coarser one is used.
+	bool indirect; // Draw with glMultiDrawArraysIndirect, otherwise each visible chunk goes into the draw list as its own range.
+
+	std::vector<DrawArraysIndirectCommand> commands; // The wall commands for the visible chunks followed by the ceiling commands.
+	GLsizei wallCommandCount;
+	GLsizei ceilingCommandCount;
+	DIB commandBuffer;
+
+	LodCave()
+	{
+		LodCave::walls = std::vector<FlatCave>();
+		LodCave::ceilings = std::vector<FlatCave>();
+		LodCave::chunks = std::vector<std::vector<MeshChunk>>();
+		LodCave::levelFirstWallVertex = std::vector<GLint>();
+		LodCave::levelFirstVertex = std::vector<GLint>();
+		LodCave::chunkLevels = std::vector<int>();
+		LodCave::lodDistance = 40.0f;
+		LodCave::indirect = GLEW_ARB_multi_draw_indirect;
+		LodCave::commands = std::vector<DrawArraysIndirectCommand>();
+		LodCave::wallCommandCount = 0;
+		LodCave::ceilingCommandCount = 0;
+	} // The command buffer is created along with the cave and filled by SelectLevels.
+
+	void Build(std::vector<std::vector<GLfloat>> levelWalls, std::vector<std::vector<GLfloat>> levelFloors, std::vector<std::vector<MeshChunk>>& levelChunks,
+		bool wireFrame, std::vector<Texture>& wallTextures)
+	{
+		std::vector<GLfloat> packedWalls = std::vector<GLfloat>();
+		std::vector<GLfloat> packedFloors = std::vector<GLfloat>();
+		levelFirstWallVertex.clear();
+		levelFirstVertex.clear();
+		for (unsigned int level = 0; level < levelChunks.size(); level++)
+		{
+			levelFirstWallVertex.push_back(GLint(packedWalls.size() / 5));
+			levelFirstVertex.push_back(GLint(packedFloors.size() / 6));
+			packedWalls.insert(packedWalls.end(), levelWalls[level].begin(), levelWalls[level].end());
+			packedFloors.insert(packedFloors.end(), levelFloors[level].begin(), levelFloors[level].end());
+			std::vector<GLfloat>().swap(levelWalls[level]);
+			std::vector<GLfloat>().swap(levelFloors[level]);
+		}
+		if (walls.empty())
+		{
+			walls.push_back(FlatCave(packedWalls.data(), packedWalls.size(), wireFrame, wallTextures));
+			ceilings.push_back(FlatCave(packedFloors.data(), packedFloors.size(), wireFrame));
+		}
+		else
+		{
+			walls[0].Upload(packedWalls.data(), packedWalls.size());
+			ceilings[0].Upload(packedFloors.data(), packedFloors.size());
+		}
+		chunks = levelChunks;
+	} // Every level must be split into the same chunks as the first. A cave that has been built before reuses its buffers and textures, so the textures are
+	  // only taken the first time. Move the level vertices in, each level is freed as soon as it has been packed and the packed copy once it is uploaded.
+
+	void Clear()
+	{
+		chunks.clear();
+		levelFirstWallVertex.clear();
+		levelFirstVertex.clear();
+		chunkLevels.clear();
+		commands.clear();
+		wallCommandCount = 0;
+		ceilingCommandCount = 0;
+	} // Empties the cave so nothing is drawn, but keeps its buffers for the next Build.
+
+	void SelectLevels(glm::vec3 viewPosition, const glm::mat4& viewProjection)
+	{
+		glm::vec4 planes[6];
+		for (int i = 0; i < 3; i++)
+		{
+			glm::vec4 row = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+			glm::vec4 lastRow = glm::vec4(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+			planes[i * 2] = lastRow + row;
+			planes[i * 2 + 1] = lastRow - row;
+		}
+
+		chunkLevels = std::vector<int>(chunks.empty() ? 0 : chunks[0].size(), 0);
+		for (unsigned int i = 0; i < chunkLevels.size(); i++)
+		{
+			if (!InView(planes, chunks[0][i].boundsMin, chunks[0][i].boundsMax))
+			{
+				chunkLevels[i] = -1;
+				continue;
+			}
+			glm::vec3 closestPoint = glm::clamp(viewPosition, chunks[0][i].boundsMin, chunks[0][i].boundsMax);
+			int level = int(glm::distance(viewPosition, closestPoint) / lodDistance);
+			chunkLevels[i] = std::min(level, int(chunks.size()) - 1);
+		}
+
+		if (indirect)
+		{
+			WriteCommands();
+		}
+	} // Picks a level for each chunk from how far the view position, in the cave's own space, is from the nearest point of the chunk. Chunks outside the view,
+	  // whose matrix must also take the cave's own space, are left out. A chunk's bounds reach from the ceiling down to the floor, so one test covers all three.
+
+	void QueueWalls(DrawList& drawList, Shader& shader, GLint modelLocation, const glm::mat4& model)
+	{
+		if (walls.empty())
+		{
+			return;
+		}
+		if (indirect)
+		{
+			drawList.AddIndirect(shader, modelLocation, model, walls[0], commandBuffer, 0, wallCommandCount);
+			return;
+		}
+		for (unsigned int i = 0; i < chunkLevels.size(); i++)
+		{
+			if (chunkLevels[i] >= 0)
+			{
+				MeshChunk& chunk = chunks[chunkLevels[i]][i];
+				drawList.Add(shader, modelLocation, model, walls[0], levelFirstWallVertex[chunkLevels[i]] + chunk.firstWallTriangle * 3, chunk.wallTriangleCount * 3);
+			}
+		}
+	}
+
+	void QueueCeiling(DrawList& drawList, Shader& shader, GLint modelLocation, const glm::mat4& model)
+	{
+		if (ceilings.empty())
+		{
+			return;
+		}
+		if (indirect)
+		{
+			drawList.AddIndirect(shader, modelLocation, model, ceilings[0], commandBuffer, wallCommandCount * sizeof(DrawArraysIndirectCommand), ceilingCommandCount);
+			return;
+		}
+		for (unsigned int i = 0; i < chunkLevels.size(); i++)
+		{
+			if (chunkLevels[i] >= 0)
+			{
+				MeshChunk& chunk = chunks[chunkLevels[i]][i];
+				drawList.Add(shader, modelLocation, model, ceilings[0], levelFirstVertex[chunkLevels[i]] + chunk.firstTriangle * 3, chunk.triangleCount * 3);
+			}
+		}
+	} // Queued a second time with a lower model matrix for the floor, which is the same geometry and uses the same commands.
+
+	GLsizeiptr GetBufferBytes()
+	{
+		return walls.empty() ? 0 : walls[0].bufferCapacity + ceilings[0].bufferCapacity;
+	}
+
+	void SetWireFrame(bool wireFrame)
+	{
+		for (unsigned int i = 0; i < walls.size(); i++)
+		{
+			walls[i].wireFrame = wireFrame;
+			ceilings[i].wireFrame = wireFrame;
+		}
+	}
+
+	void Delete()
+	{
+		for (unsigned int i = 0; i < walls.size(); i++)
+		{
+			walls[i].Delete();
+			ceilings[i].Delete();
+		}
+		commandBuffer.Delete();
+	}
+
+private:
+	void WriteCommands()
+	{
+		commands.clear();
+		for (unsigned int i = 0; i < chunkLevels.size(); i++)
+		{
+			if (chunkLevels[i] >= 0)
+			{
+				MeshChunk& chunk = chunks[chunkLevels[i]][i];
+				AddCommand(levelFirstWallVertex[chunkLevels[i]] + chunk.firstWallTriangle * 3, chunk.wallTriangleCount * 3, 0);
+			}
+		}
+		wallCommandCount = GLsizei(commands.size());
+		for (unsigned int i = 0; i < chunkLevels.size(); i++)
+		{
+			if (chunkLevels[i] >= 0)
+			{
+				MeshChunk& chunk = chunks[chunkLevels[i]][i];
+				AddCommand(levelFirstVertex[chunkLevels[i]] + chunk.firstTriangle * 3, chunk.triangleCount * 3, wallCommandCount);
+			}
+		}
+		ceilingCommandCount = GLsizei(commands.size()) - wallCommandCount;
+		commandBuffer.Update(commands);
+	} // Writes a command for every visible chunk and uploads them, so the draw calls themselves cost the same however many chunks there are.
+
+	void AddCommand(GLint first, GLsizei count, GLsizei groupStart)
+	{
+		if (count <= 0)
+		{
+			return;
+		}
+		if (commands.size() > size_t(groupStart) && commands.back().first + commands.back().count == GLuint(first))
+		{
+			commands.back().count += count;
+			return;
+		}
+		DrawArraysIndirectCommand command;
+		command.count = GLuint(count);
+		command.instanceCount = 1;
+		command.first = GLuint(first);
+		command.baseInstance = 0;
+		commands.push_back(command);
+	} // Neighbouring chunks at the same level follow on from each other in the buffer, so their ranges are joined into one command. Wall and ceiling commands
+	  // are never joined as they draw from different buffers.
+
+	static bool InView(const glm::vec4 planes[6], glm::vec3 boundsMin, glm::vec3 boundsMax)
+	{
+		for (int i = 0; i < 6; i++)
+		{
+			glm::vec3 farthest = glm::vec3(planes[i].x > 0.0f ? boundsMax.x : boundsMin.x, planes[i].y > 0.0f ? boundsMax.y : boundsMin.y,
+				planes[i].z > 0.0f ? boundsMax.z : boundsMin.z);
+			if (glm::dot(glm::vec3(planes[i]), farthest) + planes[i].w < 0.0f)
+			{
+				return false;
+			}
+		}
+		return true;
+	} // A box is out of view when its corner farthest along a frustum plane's normal is still behind that plane.
+}; // Holds the cave at several levels of detail and draws each chunk at the level that suits its distance from the camera.
+
+#endif
\ No newline at end of file
@@ -0,0 +1,8 @@
+#include "tests.h"
+
+int main(int argc, char** argv)
+{
+	doctest::Context context;
+	context.applyCommandLine(argc, argv);
+	return context.run();
+} // Runs every test case, doctest's own command line options such as --test-case can pick out some of them.
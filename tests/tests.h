@@ -1,20 +1,295 @@
 /**
-* DO NOT MODIFY! 
-* Test File for the FileReader
-* A final version will be relased close to the deadline with mroe detailed tests.
+* Tests for the generation headers. None of them need a window or an OpenGL context, tests.cpp runs them from the command line.
 */
-#pragma once 
+#pragma once
 #include <string>
-#include "../Project.h" 
+#include <vector>
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+#include "../generation/cave_generator.h"
+#include "../generation/mesh_generator.h"
+#include "../generation/grid_serializer.h"
+#include "../generation/cave_cache.h"
+#include "../generation/vertex_quantiser.h"
 //#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
 #define DOCTEST_CONFIG_IMPLEMENT
 #include "doctest.h"
 
+double FloorArea(const std::vector<float>& floor)
+{
+	double area = 0.0;
+	for (size_t i = 0; i + 18 <= floor.size(); i += 18)
+	{
+		double abX = floor[i + 6] - floor[i];
+		double abZ = floor[i + 8] - floor[i + 2];
+		double acX = floor[i + 12] - floor[i];
+		double acZ = floor[i + 14] - floor[i + 2];
+		area += std::fabs(abX * acZ - abZ * acX) / 2.0;
+	}
+	return area;
+} // Area of every floor triangle added up, from the interleaved buffer CreateFinalVertexBuffers gives.
+
+int CountTJunctions(const std::vector<float>& floor)
+{
+	std::vector<glm::vec2> points = std::vector<glm::vec2>();
+	for (size_t i = 0; i < floor.size(); i += 6)
+	{
+		glm::vec2 point = glm::vec2(floor[i], floor[i + 2]);
+		if (std::find(points.begin(), points.end(), point) == points.end())
+		{
+			points.push_back(point);
+		}
+	}
+
+	int tJunctions = 0;
+	for (size_t i = 0; i + 18 <= floor.size(); i += 18)
+	{
+		for (int edge = 0; edge < 3; edge++)
+		{
+			glm::vec2 start = glm::vec2(floor[i + edge * 6], floor[i + edge * 6 + 2]);
+			glm::vec2 end = glm::vec2(floor[i + (edge + 1) % 3 * 6], floor[i + (edge + 1) % 3 * 6 + 2]);
+			glm::vec2 direction = end - start;
+			for (unsigned int j = 0; j < points.size(); j++)
+			{
+				glm::vec2 offset = points[j] - start;
+				float along = glm::dot(offset, direction);
+				if (std::fabs(direction.x * offset.y - direction.y * offset.x) < 1e-4f && along > 1e-4f && along < glm::dot(direction, direction) - 1e-4f)
+				{
+					tJunctions++;
+				}
+			}
+		}
+	}
+	return tJunctions;
+} // Counts the vertices of the floor that lie inside an edge of some triangle rather than at its ends, each one can open a crack when the mesh is drawn.
+
+int CountTrianglesWithEdge(MeshGenerator& meshGenerator, int vertexA, int vertexB)
+{
+	int count = 0;
+	for (size_t i = 0; i < meshGenerator.triangles.size(); i += 3)
+	{
+		bool hasA = false;
+		bool hasB = false;
+		for (int corner = 0; corner < 3; corner++)
+		{
+			hasA = hasA || meshGenerator.triangles[i + corner] == vertexA;
+			hasB = hasB || meshGenerator.triangles[i + corner] == vertexB;
+		}
+		count += hasA && hasB ? 1 : 0;
+	}
+	return count;
+}
+
+TEST_CASE("Grid serializer round trip")
+{
+	CaveGenerator caveGenerator(53, 70, 45, 3, 5);
+	std::vector<uint8_t> encoded = GridSerializer::Encode(caveGenerator.borderedMap, caveGenerator.borderSize);
+	std::vector<std::vector<int>> decoded = std::vector<std::vector<int>>();
+	CHECK(GridSerializer::Decode(encoded, decoded, 63, 80));
+	CHECK(decoded == caveGenerator.borderedMap);
+
+	std::vector<std::vector<int>> noisy = std::vector<std::vector<int>>(40, std::vector<int>(131, 0));
+	for (int x = 0; x < 40; x++)
+	{
+		for (int y = 0; y < 131; y++)
+		{
+			noisy[x][y] = (x * 7 + y * 13 + x * y) % 5 == 0 ? 1 : 0;
+		}
+	}
+	encoded = GridSerializer::Encode(noisy, 5);
+	CHECK(GridSerializer::Decode(encoded, decoded));
+	CHECK(decoded == noisy);
+
+	encoded.pop_back();
+	CHECK_FALSE(GridSerializer::Decode(encoded, decoded));
+
+	const uint8_t tallRow[] = { 'C', 'G', GridSerializer::version, 1, 0x80, 0x80, 0x40, 0x80, 0x80, 0x04, 0x80, 0x80, 0x40 };
+	CHECK_FALSE(GridSerializer::Decode(tallRow, sizeof(tallRow), decoded));
+	const uint8_t shortRows[] = { 'C', 'G', GridSerializer::version, 2, 0x80, 0x01, 0, 0x80, 0x01, 1, 1, 1, 1 };
+	CHECK_FALSE(GridSerializer::Decode(shortRows, sizeof(shortRows), decoded));
+} // A cave with its wall border, then a grid whose border is not wall and whose rows do not fill whole 64 bit words. Cutting a byte off must fail, and so
+  // must a header that asks for a huge grid from a few bytes: one row of a million tiles inside a border of 65536, or two rows of 128 where the second stops
+  // after four tiles.
+
+TEST_CASE("Greedy merge leaves no cracks")
+{
+	for (int fill = 40; fill <= 50; fill += 5)
+	{
+		CaveGenerator caveGenerator(48, 40, fill, 11, 5);
+		MeshGenerator plain(caveGenerator.borderedMap, 1);
+		MeshGenerator greedy(caveGenerator.borderedMap, 1, true);
+		std::vector<float> plainFloor = std::vector<float>();
+		std::vector<float> plainWalls = std::vector<float>();
+		std::vector<float> greedyFloor = std::vector<float>();
+		std::vector<float> greedyWalls = std::vector<float>();
+		plain.CreateFinalVertexBuffers(plainFloor, plainWalls);
+		greedy.CreateFinalVertexBuffers(greedyFloor, greedyWalls);
+
+		CHECK(greedyFloor.size() < plainFloor.size());
+		CHECK(FloorArea(greedyFloor) == doctest::Approx(FloorArea(plainFloor)));
+		CHECK(CountTJunctions(greedyFloor) == 0);
+	}
+} // The merged floor covers exactly the same area with fewer triangles, and every vertex a neighbouring shape has on a rectangle's edge is one of its corners.
+
+TEST_CASE("Greedy merge keeps the walls")
+{
+	for (int fill = 40; fill <= 50; fill += 5)
+	{
+		CaveGenerator caveGenerator(48, 40, fill, 11, 5);
+		MeshGenerator plain(caveGenerator.borderedMap, 1);
+		MeshGenerator greedy(caveGenerator.borderedMap, 1, true);
+		CHECK(greedy.wallTriangles.size() == plain.wallTriangles.size());
+		CHECK(greedy.outlines.size() == plain.outlines.size());
+	}
+} // Merging only changes how the inside of the floor is split up, the outlines and the walls hung from them are the same.
+
+TEST_CASE("Simplified outlines keep their shape")
+{
+	CaveGenerator caveGenerator(48, 40, 45, 11, 5);
+	MeshGenerator plain(caveGenerator.borderedMap, 1);
+	MeshGenerator simplified(caveGenerator.borderedMap, 1, false, true, 0.0f);
+	CHECK(simplified.triangles == plain.triangles);
+	REQUIRE(simplified.outlines.size() == plain.outlines.size());
+	CHECK(simplified.wallTriangles.size() < plain.wallTriangles.size());
+
+	for (unsigned int i = 0; i < plain.outlines.size(); i++)
+	{
+		std::vector<int>& outline = simplified.outlines[i];
+		CHECK(outline.front() == outline.back());
+		CHECK(outline.size() <= plain.outlines[i].size());
+		for (unsigned int j = 0; j < outline.size(); j++)
+		{
+			CHECK(std::find(plain.outlines[i].begin(), plain.outlines[i].end(), outline[j]) != plain.outlines[i].end());
+		}
+	}
+} // With no tolerance only vertices on straight runs are dropped. The floor is untouched, every outline is still closed and made of its own vertices, and there are fewer walls.
+
+TEST_CASE("Outlines follow the cave contour")
+{
+	std::vector<std::vector<int>> map = std::vector<std::vector<int>>(12, std::vector<int>(12, 0));
+	for (int x = 3; x < 9; x++)
+	{
+		for (int y = 3; y < 9; y++)
+		{
+			map[x][y] = 1;
+		}
+	}
+	MeshGenerator solid(map, 1);
+	CHECK(solid.outlines.size() == 1);
+
+	map[5][5] = 0;
+	MeshGenerator holed(map, 1);
+	REQUIRE(holed.outlines.size() == 2);
+
+	size_t segments = 0;
+	for (unsigned int i = 0; i < holed.outlines.size(); i++)
+	{
+		std::vector<int>& outline = holed.outlines[i];
+		CHECK(outline.front() == outline.back());
+		for (unsigned int j = 0; j + 1 < outline.size(); j++)
+		{
+			CHECK(CountTrianglesWithEdge(holed, outline[j], outline[j + 1]) == 1);
+		}
+		segments += outline.size() - 1;
+	}
+	CHECK(holed.wallTriangles.size() == segments * 6);
+} // Neighbouring squares share the vertices on their common corners and edges, so a block of wall gives one outline around its edge and a hole in it gives a
+  // second, rather than one around every square. Every outline segment is the edge of exactly one floor triangle and has one wall quad.
+
+TEST_CASE("Maps without a square mesh to nothing")
+{
+	const int sizes[][2] = { { 0, 0 }, { 3, 0 }, { 1, 5 }, { 5, 1 } };
+	for (int i = 0; i < 4; i++)
+	{
+		std::vector<std::vector<int>> map = std::vector<std::vector<int>>(sizes[i][0], std::vector<int>(sizes[i][1], 1));
+		MeshGenerator meshGenerator(map, 1, true, false, 0.0f, 4);
+		CHECK(meshGenerator.GetSquareCountX() == 0);
+		CHECK(meshGenerator.GetSquareCountY() == 0);
+		CHECK(meshGenerator.triangles.empty());
+		CHECK(meshGenerator.wallTriangles.empty());
+		CHECK(meshGenerator.chunks.empty());
+	}
+} // A grid needs two nodes along each side to hold a square, anything narrower is an empty mesh rather than an error.
+
+TEST_CASE("Map pyramid keeps its edges")
+{
+	CaveGenerator caveGenerator(30, 25, 45, 9, 5);
+	for (int width = 9; width <= 10; width++)
+	{
+		caveGenerator.borderedMap = std::vector<std::vector<int>>(width, std::vector<int>(width, 0));
+		for (int i = 0; i < width; i++)
+		{
+			caveGenerator.borderedMap[i][width - 1] = 1;
+		}
+		caveGenerator.BuildMapPyramid(2);
+		REQUIRE(caveGenerator.GetMapLevelCount() == 2);
+
+		const std::vector<std::vector<int>>& coarser = caveGenerator.GetMapLevel(1);
+		REQUIRE(coarser.size() == size_t(width / 2 + 1));
+		for (unsigned int x = 0; x < coarser.size(); x++)
+		{
+			CHECK(coarser[x].front() == 0);
+			CHECK(coarser[x].back() == 1);
+		}
+		CHECK(coarser.back()[coarser.size() / 2] == 0);
+	}
+} // An open map with a wall along one side, at an odd and an even size. The coarser edges copy the finer ones, even the last cell of the even size that sits
+  // past the finer map.
+
+TEST_CASE("Cave cache round trip")
+{
+	CaveCache caveCache("test_cache");
+	CaveCacheKey key = CaveCache::MakeKey(30, 25, 45, 9, 5, false, false, 0.0f);
+	CaveGenerator caveGenerator(30, 25, 45, 9, 5);
+	MeshGenerator meshGenerator(caveGenerator.borderedMap, 1);
+	std::vector<float> floor = std::vector<float>();
+	std::vector<float> walls = std::vector<float>();
+	meshGenerator.CreateFinalVertexBuffers(floor, walls);
+	REQUIRE(caveCache.Store(key, caveGenerator.borderedMap, floor, walls));
+
+	std::vector<std::vector<int>> loadedMap = std::vector<std::vector<int>>();
+	std::vector<float> loadedFloor = std::vector<float>();
+	std::vector<float> loadedWalls = std::vector<float>();
+	CHECK(caveCache.Load(key, loadedMap, loadedFloor, loadedWalls));
+	CHECK(loadedMap == caveGenerator.borderedMap);
+	CHECK(loadedFloor == floor);
+	CHECK(loadedWalls == walls);
+
+	CaveCacheKey otherKey = key;
+	otherKey.seed++;
+	CHECK_FALSE(caveCache.Load(otherKey, loadedMap, loadedFloor, loadedWalls));
+	remove(caveCache.GetPath(key).c_str());
+} // A stored cave loads back exactly, and a key that was never stored is a miss.
+
+TEST_CASE("Vertex quantiser falls back to floats")
+{
+	CaveGenerator caveGenerator(30, 25, 45, 9, 5);
+	MeshGenerator meshGenerator(caveGenerator.borderedMap, 1);
+	std::vector<float> floor = std::vector<float>();
+	std::vector<float> walls = std::vector<float>();
+	meshGenerator.CreateFinalVertexBuffers(floor, walls);
+
+	VertexQuantiser quantiser(0.5f);
+	size_t floorShorts = floor.size() / 6 * 2;
+	CHECK(quantiser.Quantise(floor.data(), floor.size(), walls.data(), walls.size()));
+	CHECK(quantiser.verticesFloor.size() == floorShorts);
+
+	std::vector<float> movedFloor = floor;
+	movedFloor[0] += 0.1f;
+	CHECK_FALSE(quantiser.Quantise(movedFloor.data(), movedFloor.size(), walls.data(), walls.size()));
+	CHECK(quantiser.verticesFloor.empty());
+	CHECK(quantiser.verticesWalls.empty());
+
+	std::vector<float> changedWalls = walls;
+	changedWalls[3] = 0.5f;
+	CHECK_FALSE(quantiser.Quantise(floor.data(), floor.size(), changedWalls.data(), changedWalls.size()));
+} // A generated cave fits the lattice. A vertex moved off it, or texture coordinates the shader would not reproduce, leave nothing to upload so the floats are drawn.
 
 TEST_CASE( "STD 1:Doing something standard"  ) {
 
 }
 
 TEST_CASE("ADV 1: Doing somethign advanced") {
-    
-}
\ No newline at end of file
+
+}
@@ -3,6 +3,7 @@
 
 #include <GL/glew.h>
 #include <iostream>
+#include "render_state.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
@@ -17,7 +18,7 @@ public:
 
 		glGenTextures(1, &ID);
 
-		glBindTexture(GL_TEXTURE_2D, ID);
+		RenderState::Get().BindTexture(unit, ID);
 
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -44,8 +45,12 @@ public:
 
 	void Bind()
 	{
-		glActiveTexture(GL_TEXTURE0 + unit);
-		glBindTexture(GL_TEXTURE_2D, ID);
+		RenderState::Get().BindTexture(unit, ID);
+	}
+
+	void Delete()
+	{
+		RenderState::Get().DeleteTexture(ID);
 	}
 
 };
@@ -0,0 +1,73 @@
+#ifndef TEXTURE_CACHE_CLASS
+#define TEXTURE_CACHE_CLASS
+
+#include "texture.h"
+#include <string>
+#include <vector>
+
+// Loads each texture file once and hands the same Texture to everything that asks for it. Every Acquire must be matched by a Release, the GPU texture is freed
+// when the last one is released. FlatCave releases the textures it was given when it is deleted.
+
+struct TextureCacheEntry
+{
+	std::string filePath;
+	GLenum format;
+	Texture texture;
+	unsigned int references;
+};
+
+class TextureCache
+{
+public:
+	std::vector<TextureCacheEntry> entries;
+	unsigned int loads; // Times a file has actually been decoded and uploaded.
+
+	static TextureCache& Get()
+	{
+		static TextureCache textureCache;
+		return textureCache;
+	}
+
+	Texture Acquire(const std::string& filePath, GLenum format, GLuint slot)
+	{
+		for (unsigned int i = 0; i < entries.size(); i++)
+		{
+			if (entries[i].filePath == filePath && entries[i].format == format && entries[i].texture.unit == slot)
+			{
+				entries[i].references++;
+				return entries[i].texture;
+			}
+		}
+
+		TextureCacheEntry entry = { filePath, format, Texture(filePath, format, slot), 1 };
+		entries.push_back(entry);
+		loads++;
+		return entry.texture;
+	} // Only a handful of textures are ever loaded, so they are found by walking the list.
+
+	void Release(const Texture& texture)
+	{
+		for (unsigned int i = 0; i < entries.size(); i++)
+		{
+			if (entries[i].texture.ID == texture.ID)
+			{
+				entries[i].references--;
+				if (entries[i].references == 0)
+				{
+					entries[i].texture.Delete();
+					entries.erase(entries.begin() + i);
+				}
+				return;
+			}
+		}
+	} // Textures that did not come from the cache are ignored.
+
+private:
+	TextureCache()
+	{
+		TextureCache::entries = std::vector<TextureCacheEntry>();
+		TextureCache::loads = 0;
+	}
+};
+
+#endif
\ No newline at end of file